@@ -12,6 +12,6 @@ if ! command -v brew >/dev/null 2>&1; then
 fi
 
 brew update
-brew install cmake wxwidgets sqlite curl mosquitto create-dmg
+brew install cmake wxwidgets sqlite curl openssl@3 create-dmg
 
 echo "Done. You can now run: make build"
@@ -1,7 +1,5 @@
 #include "app/AppBootstrap.h"
 
-#include "app/ConfigLoader.h"
-
 #include <wx/filename.h>
 #include <wx/log.h>
 #include <wx/stdpaths.h>
@@ -34,8 +32,7 @@ bool EnsureDirectory(const wxString &path, wxString *error_message) {
 
 bool AppBootstrap::Initialize(wxString *error_message) {
     const wxString base_dir = wxStandardPaths::Get().GetUserDataDir();
-    ConfigLoader loader;
-    if (!loader.LoadOrCreate(base_dir, &config_, error_message)) {
+    if (!config_loader_.LoadOrCreate(base_dir, &config_, error_message)) {
         wxLogError("AppBootstrap: configuration load failed.");
         return false;
     }
@@ -75,6 +72,27 @@ ImportWatcher *AppBootstrap::GetImportWatcher() {
     return import_watcher_.get();
 }
 
+const PrinterTimeline *AppBootstrap::GetPrinterTimeline() const {
+    return printer_coordinator_ ? &printer_coordinator_->GetTimeline() : nullptr;
+}
+
+bool AppBootstrap::RegisterDiscoveredPrinters(const std::vector<DiscoveredPrinter> &printers,
+                                              size_t *added,
+                                              wxString *error_message) {
+    AppConfig updated = config_;
+    const size_t added_count = MergeDiscoveredPrinters(printers, &updated.printers);
+    if (!config_loader_.Save(updated, error_message)) {
+        wxLogError("AppBootstrap: unable to save discovered printers.");
+        return false;
+    }
+    config_.printers = std::move(updated.printers);
+    if (added) {
+        *added = added_count;
+    }
+    wxLogMessage("AppBootstrap: registered %zu new printers from discovery", added_count);
+    return true;
+}
+
 bool AppBootstrap::EnsureDirectories(wxString *error_message) const {
     return EnsureDirectory(config_.data_dir, error_message) &&
            EnsureDirectory(config_.jobs_dir, error_message) &&
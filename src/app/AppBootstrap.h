@@ -1,13 +1,16 @@
 #pragma once
 
 #include "app/AppConfig.h"
+#include "app/ConfigLoader.h"
 #include "app/DatabaseManager.h"
 #include "app/ImportWatcher.h"
 #include "app/PrinterCoordinator.h"
+#include "app/PrinterDiscovery.h"
 
 #include <wx/string.h>
 
 #include <memory>
+#include <vector>
 
 class AppBootstrap {
 public:
@@ -15,11 +18,19 @@ public:
     const AppConfig &GetConfig() const;
     DatabaseManager &GetDatabase();
     ImportWatcher *GetImportWatcher();
+    // Null until the coordinator has been created.
+    const PrinterTimeline *GetPrinterTimeline() const;
+    // Adds discovered printers to the configuration and saves it. New printers
+    // still need an access code before the coordinator will connect to them.
+    bool RegisterDiscoveredPrinters(const std::vector<DiscoveredPrinter> &printers,
+                                    size_t *added,
+                                    wxString *error_message);
 
 private:
     bool EnsureDirectories(wxString *error_message) const;
 
     AppConfig config_;
+    ConfigLoader config_loader_;
     DatabaseManager database_;
     std::unique_ptr<ImportWatcher> import_watcher_;
     std::unique_ptr<PrinterCoordinator> printer_coordinator_;
@@ -9,6 +9,7 @@ struct PrinterDefinition {
     wxString host;
     wxString access_code;
     wxString serial;
+    wxString model;
 };
 
 struct AppConfig {
@@ -16,5 +17,18 @@ struct AppConfig {
     wxString jobs_dir;
     wxString completed_dir;
     wxString import_dir;
+    long mqtt_io_threads = 1;
+    long upload_threads = 4;
+    bool upload_ahead = false;
+    long upload_ahead_minutes = 0;
+    long cache_budget_mb = 0;
+    wxString mqtt_broker_host;
+    long mqtt_broker_port = 1883;
+    bool mqtt_broker_tls = false;
+    wxString mqtt_broker_username;
+    wxString mqtt_broker_password;
+    wxString report_record_path;
+    wxString report_replay_path;
+    double report_replay_speed = 1.0;
     std::vector<PrinterDefinition> printers;
 };
@@ -0,0 +1,68 @@
+#include "app/CommandBroadcast.h"
+
+CommandBroadcast::CommandBroadcast(const wxString &command,
+                                   const std::vector<wxString> &printer_keys,
+                                   Completion handler)
+    : done_(printer_keys.size(), false),
+      remaining_(printer_keys.size()),
+      started_at_(std::chrono::steady_clock::now()),
+      handler_(std::move(handler)) {
+    result_.command = command;
+    result_.printers.resize(printer_keys.size());
+    for (size_t index = 0; index < printer_keys.size(); ++index) {
+        result_.printers[index].printer_key = printer_keys[index];
+    }
+}
+
+void CommandBroadcast::Complete(size_t index, const CommandResult &result) {
+    BroadcastResult finished;
+    Completion handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= done_.size() || done_[index]) {
+            return;
+        }
+        done_[index] = true;
+        BroadcastPrinterResult &printer = result_.printers[index];
+        printer.status = result.status;
+        printer.result = result.result;
+        printer.reason = result.reason;
+        printer.latency = result.latency;
+        if (result.status == CommandStatus::Acknowledged) {
+            result_.succeeded += 1;
+        } else if (result.status == CommandStatus::Sent) {
+            result_.published += 1;
+        } else {
+            result_.failed += 1;
+        }
+        remaining_ -= 1;
+        if (remaining_ > 0) {
+            return;
+        }
+        result_.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started_at_);
+        finished = result_;
+        handler = std::move(handler_);
+    }
+    if (handler) {
+        handler(finished);
+    }
+}
+
+void CommandBroadcast::Fail(size_t index, const wxString &reason) {
+    Finish(index, CommandStatus::SendFailed, reason);
+}
+
+void CommandBroadcast::Cancel(size_t index) {
+    Finish(index, CommandStatus::Cancelled, "The printer coordinator stopped before sending.");
+}
+
+void CommandBroadcast::Finish(size_t index, CommandStatus status, const wxString &reason) {
+    CommandResult result;
+    result.command = result_.command;
+    result.status = status;
+    result.reason = reason;
+    result.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started_at_);
+    Complete(index, result);
+}
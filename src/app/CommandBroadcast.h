@@ -0,0 +1,61 @@
+#pragma once
+
+#include "app/PrinterCommandChannel.h"
+
+#include <wx/string.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct BroadcastPrinterResult {
+    wxString printer_key;
+    CommandStatus status = CommandStatus::SendFailed;
+    wxString result;
+    wxString reason;
+    std::chrono::microseconds latency{0};
+};
+
+struct BroadcastResult {
+    wxString command;
+    std::vector<BroadcastPrinterResult> printers;
+    // Acknowledged by the printer.
+    size_t succeeded = 0;
+    // Published, but the command has no acknowledgement, so delivery is unconfirmed.
+    size_t published = 0;
+    // Rejected, timed out, not sent or cancelled.
+    size_t failed = 0;
+    // Issue to the last printer's outcome; bounded by the slowest printer.
+    std::chrono::microseconds elapsed{0};
+};
+
+// Collects per-printer outcomes of one command sent to many printers and hands
+// the aggregate to |handler| exactly once, when the last printer completes.
+// Completions may arrive from any thread.
+class CommandBroadcast {
+public:
+    using Completion = std::function<void(const BroadcastResult &result)>;
+
+    CommandBroadcast(const wxString &command,
+                     const std::vector<wxString> &printer_keys,
+                     Completion handler);
+
+    CommandBroadcast(const CommandBroadcast &) = delete;
+    CommandBroadcast &operator=(const CommandBroadcast &) = delete;
+
+    void Complete(size_t index, const CommandResult &result);
+    void Fail(size_t index, const wxString &reason);
+    void Cancel(size_t index);
+
+private:
+    void Finish(size_t index, CommandStatus status, const wxString &reason);
+
+    std::mutex mutex_;
+    BroadcastResult result_;
+    std::vector<bool> done_;
+    size_t remaining_ = 0;
+    std::chrono::steady_clock::time_point started_at_;
+    Completion handler_;
+};
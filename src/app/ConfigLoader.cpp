@@ -48,6 +48,17 @@ bool ConfigLoader::LoadOrCreate(const wxString &base_dir,
     return true;
 }
 
+bool ConfigLoader::Save(const AppConfig &config, wxString *error_message) const {
+    if (config_path_.empty()) {
+        if (error_message) {
+            *error_message = "Internal error: configuration has not been loaded.";
+        }
+        wxLogError("ConfigLoader: save requested before load.");
+        return false;
+    }
+    return ValidateConfig(config, error_message) && SaveConfig(config, error_message);
+}
+
 const wxString &ConfigLoader::GetConfigPath() const {
     return config_path_;
 }
@@ -67,6 +78,22 @@ bool ConfigLoader::LoadConfig(AppConfig *config, wxString *error_message) {
     file_config.Read("paths/jobs_dir", &config->jobs_dir, config->jobs_dir);
     file_config.Read("paths/completed_dir", &config->completed_dir, config->completed_dir);
     file_config.Read("paths/import_dir", &config->import_dir, config->import_dir);
+    file_config.Read("mqtt/io_threads", &config->mqtt_io_threads, config->mqtt_io_threads);
+    file_config.Read("ftps/upload_threads", &config->upload_threads, config->upload_threads);
+    file_config.Read("ftps/upload_ahead", &config->upload_ahead, config->upload_ahead);
+    file_config.Read("ftps/upload_ahead_minutes",
+                     &config->upload_ahead_minutes,
+                     config->upload_ahead_minutes);
+    file_config.Read("ftps/cache_budget_mb", &config->cache_budget_mb, config->cache_budget_mb);
+    file_config.Read("mqtt/broker_host", &config->mqtt_broker_host, wxEmptyString);
+    file_config.Read("mqtt/broker_port", &config->mqtt_broker_port, config->mqtt_broker_port);
+    file_config.Read("mqtt/broker_tls", &config->mqtt_broker_tls, config->mqtt_broker_tls);
+    file_config.Read("mqtt/broker_username", &config->mqtt_broker_username, wxEmptyString);
+    file_config.Read("mqtt/broker_password", &config->mqtt_broker_password, wxEmptyString);
+    file_config.Read("diagnostics/record_reports", &config->report_record_path, wxEmptyString);
+    file_config.Read("diagnostics/replay_reports", &config->report_replay_path, wxEmptyString);
+    file_config.Read(
+        "diagnostics/replay_speed", &config->report_replay_speed, config->report_replay_speed);
 
     config->printers.clear();
     file_config.SetPath("/printers");
@@ -81,6 +108,7 @@ bool ConfigLoader::LoadConfig(AppConfig *config, wxString *error_message) {
         file_config.Read("host", &printer.host, wxEmptyString);
         file_config.Read("access_code", &printer.access_code, wxEmptyString);
         file_config.Read("serial", &printer.serial, wxEmptyString);
+        file_config.Read("model", &printer.model, wxEmptyString);
         if (!printer.name.empty() || !printer.host.empty()) {
             config->printers.push_back(printer);
         }
@@ -98,6 +126,25 @@ bool ConfigLoader::SaveConfig(const AppConfig &config, wxString *error_message)
     file_config.Write("paths/jobs_dir", config.jobs_dir);
     file_config.Write("paths/completed_dir", config.completed_dir);
     file_config.Write("paths/import_dir", config.import_dir);
+    file_config.Write("mqtt/io_threads", config.mqtt_io_threads);
+    file_config.Write("ftps/upload_threads", config.upload_threads);
+    file_config.Write("ftps/upload_ahead", config.upload_ahead);
+    file_config.Write("ftps/upload_ahead_minutes", config.upload_ahead_minutes);
+    file_config.Write("ftps/cache_budget_mb", config.cache_budget_mb);
+    if (!config.mqtt_broker_host.empty()) {
+        file_config.Write("mqtt/broker_host", config.mqtt_broker_host);
+        file_config.Write("mqtt/broker_port", config.mqtt_broker_port);
+        file_config.Write("mqtt/broker_tls", config.mqtt_broker_tls);
+        file_config.Write("mqtt/broker_username", config.mqtt_broker_username);
+        file_config.Write("mqtt/broker_password", config.mqtt_broker_password);
+    }
+    if (!config.report_record_path.empty()) {
+        file_config.Write("diagnostics/record_reports", config.report_record_path);
+    }
+    if (!config.report_replay_path.empty()) {
+        file_config.Write("diagnostics/replay_reports", config.report_replay_path);
+        file_config.Write("diagnostics/replay_speed", config.report_replay_speed);
+    }
 
     file_config.SetPath("/printers");
     file_config.Write("count", static_cast<long>(config.printers.size()));
@@ -108,6 +155,9 @@ bool ConfigLoader::SaveConfig(const AppConfig &config, wxString *error_message)
         file_config.Write("host", config.printers[index].host);
         file_config.Write("access_code", config.printers[index].access_code);
         file_config.Write("serial", config.printers[index].serial);
+        if (!config.printers[index].model.empty()) {
+            file_config.Write("model", config.printers[index].model);
+        }
     }
 
     if (!file_config.Flush()) {
@@ -150,5 +200,48 @@ bool ConfigLoader::ValidateConfig(const AppConfig &config, wxString *error_messa
         wxLogError("ConfigLoader: import_dir missing in configuration.");
         return false;
     }
+    if (config.mqtt_io_threads < 1) {
+        if (error_message) {
+            *error_message = "Configuration error: mqtt/io_threads must be at least 1.";
+        }
+        wxLogError("ConfigLoader: mqtt io_threads must be at least 1.");
+        return false;
+    }
+    if (config.upload_threads < 1) {
+        if (error_message) {
+            *error_message = "Configuration error: ftps/upload_threads must be at least 1.";
+        }
+        wxLogError("ConfigLoader: ftps upload_threads must be at least 1.");
+        return false;
+    }
+    if (config.upload_ahead_minutes < 0) {
+        if (error_message) {
+            *error_message = "Configuration error: ftps/upload_ahead_minutes must not be negative.";
+        }
+        wxLogError("ConfigLoader: ftps upload_ahead_minutes is negative.");
+        return false;
+    }
+    if (config.cache_budget_mb < 0) {
+        if (error_message) {
+            *error_message = "Configuration error: ftps/cache_budget_mb must not be negative.";
+        }
+        wxLogError("ConfigLoader: ftps cache_budget_mb is negative.");
+        return false;
+    }
+    if (!config.mqtt_broker_host.empty() &&
+        (config.mqtt_broker_port < 1 || config.mqtt_broker_port > 65535)) {
+        if (error_message) {
+            *error_message = "Configuration error: mqtt/broker_port must be between 1 and 65535.";
+        }
+        wxLogError("ConfigLoader: mqtt broker_port out of range.");
+        return false;
+    }
+    if (config.report_replay_speed < 0.0) {
+        if (error_message) {
+            *error_message = "Configuration error: diagnostics/replay_speed must not be negative.";
+        }
+        wxLogError("ConfigLoader: diagnostics replay_speed is negative.");
+        return false;
+    }
     return true;
 }
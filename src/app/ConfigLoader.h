@@ -7,6 +7,7 @@
 class ConfigLoader {
 public:
     bool LoadOrCreate(const wxString &base_dir, AppConfig *config, wxString *error_message);
+    bool Save(const AppConfig &config, wxString *error_message) const;
     const wxString &GetConfigPath() const;
 
 private:
@@ -1,16 +1,40 @@
 #include "app/DatabaseManager.h"
 
+#include "app/StringUtil.h"
+
 #include <sqlite3.h>
 #include <wx/filefn.h>
 #include <wx/filename.h>
 #include <wx/log.h>
 
+#include <string_view>
+#include <utility>
+
 namespace {
 constexpr int kSchemaVersion = 2;
 
 constexpr const char kCompletedStatusName[] = "completed";
 constexpr const char kRunningStatusName[] = "running";
 constexpr const char kPrintingStatusName[] = "printing";
+
+// Only the estimated_time string of the importer's metadata JSON is needed here.
+int64_t EstimatedSecondsFromMetadata(const unsigned char *metadata) {
+    if (!metadata) {
+        return -1;
+    }
+    constexpr std::string_view kKey = "\"estimated_time\":\"";
+    const std::string_view text(reinterpret_cast<const char *>(metadata));
+    const size_t key = text.find(kKey);
+    if (key == std::string_view::npos) {
+        return -1;
+    }
+    const size_t start = key + kKey.size();
+    const size_t end = text.find('"', start);
+    if (end == std::string_view::npos) {
+        return -1;
+    }
+    return ParseDurationSeconds(text.substr(start, end - start));
+}
 }  // namespace
 
 DatabaseManager::DatabaseManager() : db_(nullptr) {}
@@ -110,6 +134,12 @@ bool DatabaseManager::InsertImportedJob(const wxString &name,
                 return false;
             }
             sqlite3_reset(stmt);
+            const int plate_id = static_cast<int>(sqlite3_last_insert_rowid(db_));
+            if (!InsertPlateFilaments(new_job_id, plate_id, plate.filaments, error_message)) {
+                sqlite3_finalize(stmt);
+                ExecuteStatement("ROLLBACK;", nullptr);
+                return false;
+            }
         }
 
         sqlite3_finalize(stmt);
@@ -119,6 +149,7 @@ bool DatabaseManager::InsertImportedJob(const wxString &name,
         ExecuteStatement("ROLLBACK;", nullptr);
         return false;
     }
+    import_count_.fetch_add(1, std::memory_order_release);
 
     if (job_id) {
         *job_id = new_job_id;
@@ -126,10 +157,51 @@ bool DatabaseManager::InsertImportedJob(const wxString &name,
     return true;
 }
 
+bool DatabaseManager::InsertPlateFilaments(int job_id,
+                                           int plate_id,
+                                           const std::vector<FilamentRecord> &filaments,
+                                           wxString *error_message) {
+    if (filaments.empty()) {
+        return true;
+    }
+    const char *filament_sql =
+        "INSERT INTO filaments (job_id, plate_id, slot, material, color_hex) "
+        "VALUES (?, ?, ?, ?, ?);";
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, filament_sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        if (error_message) {
+            *error_message = "Database error: unable to prepare filament insert.";
+        }
+        return false;
+    }
+    for (const auto &filament : filaments) {
+        sqlite3_bind_int(stmt, 1, job_id);
+        sqlite3_bind_int(stmt, 2, plate_id);
+        sqlite3_bind_int(stmt, 3, filament.slot);
+        sqlite3_bind_text(stmt, 4, filament.material.utf8_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 5, filament.color_hex.utf8_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            if (error_message) {
+                *error_message = "Database error: unable to insert filament.";
+            }
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
 bool DatabaseManager::Initialize(const wxString &data_dir, wxString *error_message) {
     db_path_ = wxFileName(data_dir, "bambu_queue.db").GetFullPath();
 
-    if (sqlite3_open(db_path_.utf8_str(), &db_) != SQLITE_OK) {
+    // The import watcher and the printer coordinator share this connection from
+    // different threads, so ask for serialized mode whatever the library default.
+    if (sqlite3_open_v2(db_path_.utf8_str(),
+                        &db_,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+                        nullptr) != SQLITE_OK) {
         if (error_message) {
             *error_message = wxString::Format("Unable to open database at %s", db_path_);
         }
@@ -773,10 +845,14 @@ bool DatabaseManager::EnsurePrinters(const std::vector<PrinterDefinition> &print
     return true;
 }
 
-bool DatabaseManager::GetNextQueuedJob(int printer_id,
-                                       QueuedJob *job,
-                                       wxString *error_message) {
-    if (!job) {
+uint64_t DatabaseManager::GetImportCount() const {
+    return import_count_.load(std::memory_order_acquire);
+}
+
+bool DatabaseManager::GetQueuedJobs(std::vector<QueuedJob> *jobs,
+                                    int after_job_id,
+                                    wxString *error_message) {
+    if (!jobs) {
         if (error_message) {
             *error_message = "Database error: queued job output missing.";
         }
@@ -784,14 +860,14 @@ bool DatabaseManager::GetNextQueuedJob(int printer_id,
     }
 
     const char *query =
-        "SELECT jobs.id, jobs.file_path, plates.plate_index "
+        "SELECT jobs.id, jobs.file_path, MIN(plates.plate_index), jobs.printer_id, "
+        "jobs.metadata "
         "FROM jobs "
         "JOIN statuses ON jobs.status_id = statuses.id "
         "JOIN plates ON plates.job_id = jobs.id "
-        "WHERE statuses.name = 'queued' "
-        "AND (jobs.printer_id IS NULL OR jobs.printer_id = ?) "
-        "ORDER BY jobs.created_at ASC "
-        "LIMIT 1;";
+        "WHERE statuses.name = 'queued' AND jobs.id > ? "
+        "GROUP BY jobs.id "
+        "ORDER BY jobs.created_at ASC, jobs.id ASC;";
 
     sqlite3_stmt *stmt = nullptr;
     if (sqlite3_prepare_v2(db_, query, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -802,27 +878,84 @@ bool DatabaseManager::GetNextQueuedJob(int printer_id,
         return false;
     }
 
-    sqlite3_bind_int(stmt, 1, printer_id);
-    const int rc = sqlite3_step(stmt);
-    if (rc == SQLITE_ROW) {
-        job->id = sqlite3_column_int(stmt, 0);
-        job->file_path = wxString::FromUTF8(
+    sqlite3_bind_int(stmt, 1, after_job_id);
+    jobs->clear();
+    int rc = SQLITE_ROW;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        QueuedJob job;
+        job.id = sqlite3_column_int(stmt, 0);
+        job.file_path = wxString::FromUTF8(
             reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
-        job->plate_index = sqlite3_column_int(stmt, 2);
-    } else if (rc == SQLITE_DONE) {
-        job->id = 0;
-        job->file_path.clear();
-        job->plate_index = 0;
-    } else {
+        job.plate_index = sqlite3_column_int(stmt, 2);
+        job.printer_id = sqlite3_column_int(stmt, 3);
+        job.estimated_seconds = EstimatedSecondsFromMetadata(sqlite3_column_text(stmt, 4));
+        jobs->push_back(std::move(job));
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
         if (error_message) {
             *error_message = "Database error: unable to read queued jobs.";
         }
         wxLogError("DatabaseManager: queued job query failed.");
-        sqlite3_finalize(stmt);
+        return false;
+    }
+    return ReadQueuedJobFilaments(jobs, error_message);
+}
+
+bool DatabaseManager::ReadQueuedJobFilaments(std::vector<QueuedJob> *jobs,
+                                             wxString *error_message) {
+    if (jobs->empty()) {
+        return true;
+    }
+    const char *query =
+        "SELECT filaments.job_id, plates.plate_index, filaments.plate_id, filaments.slot, "
+        "filaments.material, filaments.color_hex "
+        "FROM filaments "
+        "JOIN plates ON filaments.plate_id = plates.id "
+        "JOIN jobs ON filaments.job_id = jobs.id "
+        "JOIN statuses ON jobs.status_id = statuses.id "
+        "WHERE statuses.name = 'queued' "
+        "ORDER BY filaments.job_id ASC, filaments.slot ASC;";
+
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, query, -1, &stmt, nullptr) != SQLITE_OK) {
+        if (error_message) {
+            *error_message = "Database error: unable to read job filaments.";
+        }
+        wxLogError("DatabaseManager: unable to prepare job filament query.");
         return false;
     }
 
+    // Only the plate each job will print counts; other plates may use other slots.
+    std::map<std::pair<int, int>, QueuedJob *> jobs_by_plate;
+    for (QueuedJob &job : *jobs) {
+        jobs_by_plate.emplace(std::make_pair(job.id, job.plate_index), &job);
+    }
+    int rc = SQLITE_ROW;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const auto it = jobs_by_plate.find(
+            std::make_pair(sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1)));
+        if (it == jobs_by_plate.end()) {
+            continue;
+        }
+        FilamentRecord filament;
+        filament.job_id = it->first.first;
+        filament.plate_id = sqlite3_column_int(stmt, 2);
+        filament.slot = sqlite3_column_int(stmt, 3);
+        filament.material = wxString::FromUTF8(
+            reinterpret_cast<const char *>(sqlite3_column_text(stmt, 4)));
+        filament.color_hex = wxString::FromUTF8(
+            reinterpret_cast<const char *>(sqlite3_column_text(stmt, 5)));
+        it->second->filaments.push_back(std::move(filament));
+    }
     sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        if (error_message) {
+            *error_message = "Database error: unable to read job filaments.";
+        }
+        wxLogError("DatabaseManager: job filament query failed.");
+        return false;
+    }
     return true;
 }
 
@@ -839,7 +972,11 @@ bool DatabaseManager::AssignJobToPrinter(int job_id, int printer_id, wxString *e
         return false;
     }
 
-    sqlite3_bind_int(stmt, 1, printer_id);
+    if (printer_id == 0) {
+        sqlite3_bind_null(stmt, 1);
+    } else {
+        sqlite3_bind_int(stmt, 1, printer_id);
+    }
     sqlite3_bind_int(stmt, 2, job_id);
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         if (error_message) {
@@ -854,6 +991,36 @@ bool DatabaseManager::AssignJobToPrinter(int job_id, int printer_id, wxString *e
     return true;
 }
 
+bool DatabaseManager::RequeueJobs(const wxString &status_name, wxString *error_message) {
+    sqlite3_stmt *stmt = nullptr;
+    const char *query =
+        "UPDATE jobs SET status = 'queued', "
+        "status_id = (SELECT id FROM statuses WHERE name = 'queued'), "
+        "updated_at = datetime('now') "
+        "WHERE status_id = (SELECT id FROM statuses WHERE name = ?);";
+
+    if (sqlite3_prepare_v2(db_, query, -1, &stmt, nullptr) != SQLITE_OK) {
+        if (error_message) {
+            *error_message = "Database error: unable to prepare job requeue.";
+        }
+        wxLogError("DatabaseManager: unable to prepare job requeue.");
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, status_name.utf8_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        if (error_message) {
+            *error_message = "Database error: unable to requeue jobs.";
+        }
+        wxLogError("DatabaseManager: requeue of %s jobs failed.", status_name);
+        sqlite3_finalize(stmt);
+        return false;
+    }
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
 bool DatabaseManager::FindActiveJobByFileName(const wxString &file_name,
                                               int printer_id,
                                               int *job_id,
@@ -869,7 +1036,7 @@ bool DatabaseManager::FindActiveJobByFileName(const wxString &file_name,
         "SELECT jobs.id, jobs.file_path, jobs.printer_id "
         "FROM jobs "
         "JOIN statuses ON jobs.status_id = statuses.id "
-        "WHERE statuses.is_completed = 0;";
+        "WHERE statuses.is_terminal = 0;";
 
     sqlite3_stmt *stmt = nullptr;
     if (sqlite3_prepare_v2(db_, query, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -4,6 +4,8 @@
 
 #include <wx/string.h>
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -32,11 +34,6 @@ struct PlateRecord {
     int status_id = 0;
 };
 
-struct PlateDefinition {
-    int plate_index = 0;
-    wxString name;
-};
-
 struct FilamentRecord {
     int id = 0;
     int job_id = 0;
@@ -48,6 +45,12 @@ struct FilamentRecord {
     wxString metadata;
 };
 
+struct PlateDefinition {
+    int plate_index = 0;
+    wxString name;
+    std::vector<FilamentRecord> filaments;
+};
+
 struct PrinterRecord {
     int id = 0;
     wxString name;
@@ -67,6 +70,11 @@ struct QueuedJob {
     int id = 0;
     wxString file_path;
     int plate_index = 0;
+    // 0 when any printer may take the job.
+    int printer_id = 0;
+    // From the slicer's estimate in the job metadata; -1 when there is none.
+    int64_t estimated_seconds = -1;
+    std::vector<FilamentRecord> filaments;
 };
 
 class DatabaseManager {
@@ -90,8 +98,15 @@ public:
     bool EnsurePrinters(const std::vector<PrinterDefinition> &printers,
                         std::map<wxString, int> *printer_ids,
                         wxString *error_message);
-    bool GetNextQueuedJob(int printer_id, QueuedJob *job, wxString *error_message);
+    // Every queued job with an id above |after_job_id|, oldest first, with its lowest plate.
+    bool GetQueuedJobs(std::vector<QueuedJob> *jobs, int after_job_id, wxString *error_message);
+    // Counts the jobs imported so far, so a reader can tell when to look for new ones.
+    uint64_t GetImportCount() const;
+    // A printer_id of 0 clears the assignment.
     bool AssignJobToPrinter(int job_id, int printer_id, wxString *error_message);
+    // Puts every job in |status_name| back in the queue, e.g. uploads cut off by a restart.
+    bool RequeueJobs(const wxString &status_name, wxString *error_message);
+    // Active means not yet in a terminal status (completed, failed or cancelled).
     bool FindActiveJobByFileName(const wxString &file_name,
                                  int printer_id,
                                  int *job_id,
@@ -100,6 +115,11 @@ public:
     bool JobExistsForFile(const wxString &file_path);
 
 private:
+    bool InsertPlateFilaments(int job_id,
+                              int plate_id,
+                              const std::vector<FilamentRecord> &filaments,
+                              wxString *error_message);
+    bool ReadQueuedJobFilaments(std::vector<QueuedJob> *jobs, wxString *error_message);
     bool RunMigrations(wxString *error_message);
     bool ExecuteStatement(const wxString &statement, wxString *error_message);
     bool ExecuteStatementAllowDuplicateColumn(const wxString &statement, wxString *error_message);
@@ -121,4 +141,5 @@ private:
 
     sqlite3 *db_;
     wxString db_path_;
+    std::atomic<uint64_t> import_count_{0};
 };
@@ -0,0 +1,220 @@
+#include "app/FilamentCompatibility.h"
+
+#include "app/StringUtil.h"
+
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+#include <unordered_set>
+
+namespace {
+constexpr size_t kBitsPerWord = 64;
+constexpr size_t kColorDigits = 6;
+constexpr int kTraysPerUnit = 4;
+
+// "PLA" and "#ffffff" from the slicer, "pla" and "FFFFFFFF" (RGBA) from the printer.
+std::string KindKey(std::string_view material, std::string_view color) {
+    while (!material.empty() && std::isspace(static_cast<unsigned char>(material.front()))) {
+        material.remove_prefix(1);
+    }
+    while (!material.empty() && std::isspace(static_cast<unsigned char>(material.back()))) {
+        material.remove_suffix(1);
+    }
+    if (!color.empty() && color.front() == '#') {
+        color.remove_prefix(1);
+    }
+    color = color.substr(0, kColorDigits);
+
+    std::string key;
+    key.reserve(material.size() + 1 + color.size());
+    for (const char ch : material) {
+        key.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(ch))));
+    }
+    key.push_back('/');
+    for (const char ch : color) {
+        key.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(ch))));
+    }
+    return key;
+}
+
+void SetBit(std::vector<uint64_t> *bits, size_t index) {
+    const size_t word = index / kBitsPerWord;
+    if (bits->size() <= word) {
+        bits->resize(word + 1, 0);
+    }
+    (*bits)[word] |= uint64_t{1} << (index % kBitsPerWord);
+}
+}  // namespace
+
+bool CompatibilityMatrix::SetPrinterTrays(int printer_id, const std::vector<AmsTrayState> &trays) {
+    Bits loaded;
+    bool checked = false;
+    for (const AmsTrayState &tray : trays) {
+        if (tray.material.empty()) {
+            continue;
+        }
+        SetBit(&loaded, InternKind(KindKey(tray.material, tray.color)));
+        checked = true;
+    }
+
+    auto [it, inserted] = printers_.try_emplace(printer_id);
+    PrinterColumn &printer = it->second;
+    if (inserted) {
+        printer.column = printers_.size() - 1;
+        EnsureColumns(printers_.size());
+    } else if (printer.checked == checked && printer.loaded == loaded) {
+        return false;
+    }
+    printer.loaded = std::move(loaded);
+    printer.checked = checked;
+    for (const auto &entry : jobs_) {
+        SetCell(entry.second.row, printer.column, Matches(entry.second.needed, printer));
+    }
+    return true;
+}
+
+void CompatibilityMatrix::SyncJobs(const std::vector<QueuedJob> &jobs) {
+    std::unordered_set<int> listed;
+    listed.reserve(jobs.size());
+    for (const QueuedJob &job : jobs) {
+        listed.insert(job.id);
+        if (jobs_.count(job.id) != 0) {
+            continue;
+        }
+        JobRow entry;
+        for (const FilamentRecord &filament : job.filaments) {
+            if (!filament.material.empty()) {
+                SetBit(&entry.needed,
+                       InternKind(KindKey(ToUtf8(filament.material), ToUtf8(filament.color_hex))));
+            }
+        }
+        if (free_rows_.empty()) {
+            entry.row = row_count_++;
+            cells_.resize(row_count_ * words_per_row_, 0);
+        } else {
+            entry.row = free_rows_.back();
+            free_rows_.pop_back();
+        }
+        for (const auto &printer : printers_) {
+            SetCell(entry.row, printer.second.column, Matches(entry.needed, printer.second));
+        }
+        jobs_.emplace(job.id, std::move(entry));
+    }
+
+    for (auto it = jobs_.begin(); it != jobs_.end();) {
+        if (listed.count(it->first) != 0) {
+            ++it;
+            continue;
+        }
+        free_rows_.push_back(it->second.row);
+        it = jobs_.erase(it);
+    }
+}
+
+bool CompatibilityMatrix::IsCompatible(int job_id, int printer_id) const {
+    const auto job = jobs_.find(job_id);
+    const auto printer = printers_.find(printer_id);
+    if (job == jobs_.end() || printer == printers_.end()) {
+        return true;
+    }
+    return GetCell(job->second.row, printer->second.column);
+}
+
+bool CompatibilityMatrix::HasCompatiblePrinter(int job_id) const {
+    const auto job = jobs_.find(job_id);
+    if (job == jobs_.end() || printers_.empty()) {
+        return true;
+    }
+    const auto row = cells_.begin() + static_cast<std::ptrdiff_t>(job->second.row * words_per_row_);
+    return std::any_of(row, row + static_cast<std::ptrdiff_t>(words_per_row_), [](uint64_t word) {
+        return word != 0;
+    });
+}
+
+size_t CompatibilityMatrix::InternKind(const std::string &key) {
+    return kinds_.try_emplace(key, kinds_.size()).first->second;
+}
+
+bool CompatibilityMatrix::Matches(const Bits &needed, const PrinterColumn &printer) const {
+    if (!printer.checked) {
+        return true;
+    }
+    for (size_t word = 0; word < needed.size(); ++word) {
+        const uint64_t loaded = word < printer.loaded.size() ? printer.loaded[word] : 0;
+        if ((needed[word] & ~loaded) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CompatibilityMatrix::SetCell(size_t row, size_t column, bool compatible) {
+    uint64_t &word = cells_[row * words_per_row_ + column / kBitsPerWord];
+    const uint64_t bit = uint64_t{1} << (column % kBitsPerWord);
+    word = compatible ? word | bit : word & ~bit;
+}
+
+bool CompatibilityMatrix::GetCell(size_t row, size_t column) const {
+    const uint64_t word = cells_[row * words_per_row_ + column / kBitsPerWord];
+    return (word >> (column % kBitsPerWord)) & 1;
+}
+
+void CompatibilityMatrix::EnsureColumns(size_t column_count) {
+    const size_t words = (column_count + kBitsPerWord - 1) / kBitsPerWord;
+    if (words <= words_per_row_) {
+        return;
+    }
+    std::vector<uint64_t> cells(row_count_ * words, 0);
+    for (size_t row = 0; row < row_count_; ++row) {
+        std::copy_n(cells_.begin() + static_cast<std::ptrdiff_t>(row * words_per_row_),
+                    words_per_row_,
+                    cells.begin() + static_cast<std::ptrdiff_t>(row * words));
+    }
+    cells_ = std::move(cells);
+    words_per_row_ = words;
+}
+
+std::string BuildAmsMapping(const std::vector<FilamentRecord> &filaments,
+                            const std::vector<AmsTrayState> &trays) {
+    int slot_count = 0;
+    for (const FilamentRecord &filament : filaments) {
+        slot_count = std::max(slot_count, filament.slot);
+    }
+    if (slot_count == 0) {
+        return std::string();
+    }
+
+    std::vector<int> mapping(static_cast<size_t>(slot_count), -1);
+    bool any_mapped = false;
+    for (const FilamentRecord &filament : filaments) {
+        if (filament.slot < 1 || filament.material.empty()) {
+            continue;
+        }
+        const std::string wanted =
+            KindKey(ToUtf8(filament.material), ToUtf8(filament.color_hex));
+        const auto tray =
+            std::find_if(trays.begin(), trays.end(), [&wanted](const AmsTrayState &candidate) {
+                return !candidate.material.empty() &&
+                       KindKey(candidate.material, candidate.color) == wanted;
+            });
+        if (tray != trays.end()) {
+            mapping[static_cast<size_t>(filament.slot - 1)] =
+                tray->ams_id * kTraysPerUnit + tray->tray_id;
+            any_mapped = true;
+        }
+    }
+    if (!any_mapped) {
+        // No AMS, or an external spool: let the printer use what it has loaded.
+        return std::string();
+    }
+
+    std::string json = "[";
+    for (size_t index = 0; index < mapping.size(); ++index) {
+        if (index > 0) {
+            json.push_back(',');
+        }
+        json += std::to_string(mapping[index]);
+    }
+    json.push_back(']');
+    return json;
+}
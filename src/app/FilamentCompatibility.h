@@ -0,0 +1,66 @@
+#pragma once
+
+#include "app/DatabaseManager.h"
+#include "app/PrinterReport.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Which queued jobs each printer can run with the filament loaded in its AMS.
+// Every material and color pair seen gets a bit, so a job's needs and a printer's
+// trays are both bitsets and "can run" is a subset test. The answers are kept as
+// a job by printer bit matrix: a job is tested against every printer once when it
+// is added, and a printer against every job only when its trays change, so a
+// dispatch-time lookup is two hash probes and a bit test.
+//
+// Jobs with no recorded filament, and printers that report no loaded trays (no
+// AMS, or an external spool only), cannot be checked and match everything.
+class CompatibilityMatrix {
+public:
+    // Returns true if the printer's loaded filament changed.
+    bool SetPrinterTrays(int printer_id, const std::vector<AmsTrayState> &trays);
+    // Adds the jobs not yet in the matrix and drops those no longer listed.
+    void SyncJobs(const std::vector<QueuedJob> &jobs);
+    bool IsCompatible(int job_id, int printer_id) const;
+    // False only for a known job that no known printer can run.
+    bool HasCompatiblePrinter(int job_id) const;
+
+private:
+    using Bits = std::vector<uint64_t>;
+
+    struct PrinterColumn {
+        size_t column = 0;
+        Bits loaded;
+        bool checked = false;
+    };
+
+    struct JobRow {
+        size_t row = 0;
+        Bits needed;
+    };
+
+    size_t InternKind(const std::string &key);
+    bool Matches(const Bits &needed, const PrinterColumn &printer) const;
+    void SetCell(size_t row, size_t column, bool compatible);
+    bool GetCell(size_t row, size_t column) const;
+    void EnsureColumns(size_t column_count);
+
+    std::unordered_map<std::string, size_t> kinds_;
+    std::unordered_map<int, PrinterColumn> printers_;
+    std::unordered_map<int, JobRow> jobs_;
+    std::vector<size_t> free_rows_;
+    size_t row_count_ = 0;
+    size_t words_per_row_ = 1;
+    // Row-major; each row is words_per_row_ words of printer bits.
+    std::vector<uint64_t> cells_;
+};
+
+// The "ams_mapping" array for a project_file command: for each of the job's
+// filament slots, the global index (unit * 4 + tray) of a loaded tray with the
+// same material and color, or -1. Empty if the job records no filament or no
+// slot matches a tray, in which case the command goes out without AMS fields.
+std::string BuildAmsMapping(const std::vector<FilamentRecord> &filaments,
+                            const std::vector<AmsTrayState> &trays);
@@ -2,8 +2,11 @@
 
 #include <curl/curl.h>
 #include <wx/log.h>
+#include <wx/tokenzr.h>
 #include <wx/wfstream.h>
 
+#include <string>
+
 namespace {
 class CurlGlobal {
 public:
@@ -15,23 +18,92 @@ CurlGlobal &EnsureCurlGlobal() {
     static CurlGlobal instance;
     return instance;
 }
-}  // namespace
 
-bool FtpsClient::UploadFile(const wxString &host,
-                            const wxString &access_code,
-                            const wxString &local_path,
-                            const wxString &remote_name,
-                            wxString *error_message) {
+// Opens an easy handle logged in to the printer's FTPS server at |path|, or
+// reports why not with |action| naming the operation.
+CURL *OpenSession(const wxString &host,
+                  const wxString &access_code,
+                  const wxString &path,
+                  const char *action,
+                  wxString *error_message) {
     EnsureCurlGlobal();
-
     if (host.empty() || access_code.empty()) {
         if (error_message) {
-            *error_message = "FTPS upload failed: missing host or access code.";
+            *error_message = wxString::Format("FTPS %s failed: missing host or access code.",
+                                              action);
         }
         wxLogError("FtpsClient: missing host or access code.");
+        return nullptr;
+    }
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        if (error_message) {
+            *error_message = wxString::Format("FTPS %s failed: unable to initialize curl.",
+                                              action);
+        }
+        wxLogError("FtpsClient: curl initialization failed.");
+        return nullptr;
+    }
+    const wxString url = wxString::Format("ftps://%s:990/%s", host, path);
+    const wxString userpwd = wxString::Format("bblp:%s", access_code);
+    curl_easy_setopt(curl, CURLOPT_URL, url.utf8_str().data());
+    curl_easy_setopt(curl, CURLOPT_USERPWD, userpwd.utf8_str().data());
+    curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    return curl;
+}
+
+bool Perform(CURL *curl, const char *action, wxString *error_message) {
+    const CURLcode result = curl_easy_perform(curl);
+    if (result == CURLE_OK) {
+        return true;
+    }
+    if (error_message) {
+        *error_message = wxString::Format("FTPS %s failed: %s", action, curl_easy_strerror(result));
+    }
+    wxLogError("FtpsClient: %s failed: %s", action, curl_easy_strerror(result));
+    return false;
+}
+
+size_t AppendToString(char *buffer, size_t size, size_t nitems, void *userdata) {
+    static_cast<std::string *>(userdata)->append(buffer, size * nitems);
+    return size * nitems;
+}
+
+// One line of a Unix-style listing: permissions, links, owner, group, size,
+// three date fields, then the name, which may itself contain spaces.
+bool ParseListLine(const wxString &line, RemoteFile *file) {
+    constexpr int kFieldsBeforeName = 8;
+    wxStringTokenizer fields(line, " ", wxTOKEN_STRTOK);
+    wxString size_field;
+    for (int index = 0; index < kFieldsBeforeName; ++index) {
+        if (!fields.HasMoreTokens()) {
+            return false;
+        }
+        const wxString field = fields.GetNextToken();
+        if (index == 0 && !field.StartsWith("-")) {
+            return false;
+        }
+        if (index == 4) {
+            size_field = field;
+        }
+    }
+    unsigned long long size = 0;
+    file->name = fields.GetString().Trim(false);
+    if (file->name.empty() || !size_field.ToULongLong(&size)) {
         return false;
     }
+    file->size = size;
+    return true;
+}
+}  // namespace
 
+bool FtpsClient::UploadFile(const wxString &host,
+                            const wxString &access_code,
+                            const wxString &local_path,
+                            const wxString &remote_name,
+                            wxString *error_message) {
     wxFileInputStream input(local_path);
     if (!input.IsOk()) {
         if (error_message) {
@@ -41,23 +113,10 @@ bool FtpsClient::UploadFile(const wxString &host,
         return false;
     }
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = OpenSession(host, access_code, remote_name, "upload", error_message);
     if (!curl) {
-        if (error_message) {
-            *error_message = "FTPS upload failed: unable to initialize curl.";
-        }
-        wxLogError("FtpsClient: curl initialization failed.");
         return false;
     }
-
-    wxString url = wxString::Format("ftps://%s:990/%s", host, remote_name);
-    wxString userpwd = wxString::Format("bblp:%s", access_code);
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.utf8_str());
-    curl_easy_setopt(curl, CURLOPT_USERPWD, userpwd.utf8_str());
-    curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
 
     const auto size = input.GetLength();
@@ -76,18 +135,97 @@ bool FtpsClient::UploadFile(const wxString &host,
                      });
     curl_easy_setopt(curl, CURLOPT_READDATA, &input);
 
-    CURLcode result = curl_easy_perform(curl);
-    if (result != CURLE_OK) {
+    const bool ok = Perform(curl, "upload", error_message);
+    curl_easy_cleanup(curl);
+    if (ok) {
+        wxLogMessage("FtpsClient: uploaded %s to %s as %s", local_path, host, remote_name);
+    }
+    return ok;
+}
+
+bool FtpsClient::ListFiles(const wxString &host,
+                           const wxString &access_code,
+                           std::vector<RemoteFile> *files,
+                           wxString *error_message) {
+    CURL *curl = OpenSession(host, access_code, wxEmptyString, "listing", error_message);
+    if (!curl) {
+        return false;
+    }
+    std::string listing;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &listing);
+    const bool ok = Perform(curl, "listing", error_message);
+    curl_easy_cleanup(curl);
+    if (!ok) {
+        return false;
+    }
+
+    files->clear();
+    wxStringTokenizer lines(wxString::FromUTF8(listing.data(), listing.size()), "\r\n");
+    while (lines.HasMoreTokens()) {
+        RemoteFile file;
+        if (ParseListLine(lines.GetNextToken(), &file)) {
+            files->push_back(std::move(file));
+        }
+    }
+    return true;
+}
+
+bool FtpsClient::GetFileSize(const wxString &host,
+                             const wxString &access_code,
+                             const wxString &remote_name,
+                             bool *exists,
+                             uint64_t *size,
+                             wxString *error_message) {
+    CURL *curl = OpenSession(host, access_code, remote_name, "size check", error_message);
+    if (!curl) {
+        return false;
+    }
+    // With no body curl stops after SIZE, which answers 550 for a missing file.
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    const CURLcode result = curl_easy_perform(curl);
+    curl_off_t length = -1;
+    if (result == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    }
+    curl_easy_cleanup(curl);
+
+    if (result == CURLE_REMOTE_FILE_NOT_FOUND) {
+        *exists = false;
+        *size = 0;
+        return true;
+    }
+    if (result != CURLE_OK || length < 0) {
+        const char *reason =
+            result != CURLE_OK ? curl_easy_strerror(result) : "server did not report a size";
         if (error_message) {
-            *error_message = wxString::Format("FTPS upload failed: %s",
-                                              curl_easy_strerror(result));
+            *error_message = wxString::Format("FTPS size check failed: %s", reason);
         }
-        wxLogError("FtpsClient: upload failed: %s", curl_easy_strerror(result));
-        curl_easy_cleanup(curl);
+        wxLogWarning("FtpsClient: size check of %s failed: %s", remote_name, reason);
         return false;
     }
+    *exists = true;
+    *size = static_cast<uint64_t>(length);
+    return true;
+}
 
+bool FtpsClient::RemoveFile(const wxString &host,
+                            const wxString &access_code,
+                            const wxString &remote_name,
+                            wxString *error_message) {
+    CURL *curl = OpenSession(host, access_code, wxEmptyString, "delete", error_message);
+    if (!curl) {
+        return false;
+    }
+    const wxString command = "DELE " + remote_name;
+    curl_slist *commands = curl_slist_append(nullptr, command.utf8_str().data());
+    curl_easy_setopt(curl, CURLOPT_QUOTE, commands);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    const bool ok = Perform(curl, "delete", error_message);
     curl_easy_cleanup(curl);
-    wxLogMessage("FtpsClient: uploaded %s to %s", local_path, url);
-    return true;
+    curl_slist_free_all(commands);
+    if (ok) {
+        wxLogMessage("FtpsClient: removed %s from %s", remote_name, host);
+    }
+    return ok;
 }
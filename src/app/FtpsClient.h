@@ -2,6 +2,14 @@
 
 #include <wx/string.h>
 
+#include <cstdint>
+#include <vector>
+
+struct RemoteFile {
+    wxString name;
+    uint64_t size = 0;
+};
+
 class FtpsClient {
 public:
     bool UploadFile(const wxString &host,
@@ -9,4 +17,20 @@ public:
                     const wxString &local_path,
                     const wxString &remote_name,
                     wxString *error_message);
+    // Regular files in the printer's root directory, from a single LIST.
+    bool ListFiles(const wxString &host,
+                   const wxString &access_code,
+                   std::vector<RemoteFile> *files,
+                   wxString *error_message);
+    // Succeeds with |exists| false when the printer has no file by that name.
+    bool GetFileSize(const wxString &host,
+                     const wxString &access_code,
+                     const wxString &remote_name,
+                     bool *exists,
+                     uint64_t *size,
+                     wxString *error_message);
+    bool RemoveFile(const wxString &host,
+                    const wxString &access_code,
+                    const wxString &remote_name,
+                    wxString *error_message);
 };
@@ -1,5 +1,7 @@
 #include "app/ImportWatcher.h"
 
+#include "app/StringUtil.h"
+
 #include <wx/dir.h>
 #include <wx/filename.h>
 #include <wx/log.h>
@@ -10,8 +12,7 @@ namespace {
 constexpr int kScanIntervalMs = 2000;
 
 bool IsGcode3mfFile(const wxFileName &file) {
-    const wxString lower = file.GetFullName().Lower();
-    return lower.EndsWith(".gcode.3mf");
+    return EndsWithNoCase(file.GetFullName(), ".gcode.3mf");
 }
 }  // namespace
 
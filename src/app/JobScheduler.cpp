@@ -0,0 +1,90 @@
+#include "app/JobScheduler.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+constexpr int64_t kDefaultJobSeconds = 60 * 60;
+}  // namespace
+
+int JobScheduler::PickJob(const std::vector<SchedulerJob> &jobs,
+                          const std::vector<SchedulerPrinter> &printers,
+                          int printer_id,
+                          const Eligibility &eligible) {
+    const auto requester_it =
+        std::find_if(printers.begin(), printers.end(), [printer_id](const SchedulerPrinter &p) {
+            return p.printer_id == printer_id;
+        });
+    if (requester_it == printers.end() || jobs.empty()) {
+        return 0;
+    }
+    const auto requester = static_cast<size_t>(requester_it - printers.begin());
+
+    int64_t estimated_total = 0;
+    size_t estimated_count = 0;
+    for (const SchedulerJob &job : jobs) {
+        if (job.estimated_seconds >= 0) {
+            estimated_total += job.estimated_seconds;
+            ++estimated_count;
+        }
+    }
+    const int64_t fallback = estimated_count > 0
+                                 ? estimated_total / static_cast<int64_t>(estimated_count)
+                                 : kDefaultJobSeconds;
+
+    durations_.resize(jobs.size());
+    order_.resize(jobs.size());
+    for (size_t index = 0; index < jobs.size(); ++index) {
+        durations_[index] = jobs[index].estimated_seconds >= 0 ? jobs[index].estimated_seconds
+                                                               : fallback;
+        order_[index] = index;
+    }
+    // Jobs arrive oldest first; a stable sort keeps that order among equal lengths.
+    std::stable_sort(order_.begin(), order_.end(), [this](size_t lhs, size_t rhs) {
+        return durations_[lhs] > durations_[rhs];
+    });
+
+    // Printers are ranked for tie-breaks with the requester first, so a printer
+    // asking for work is never passed over for another that is just as free.
+    auto rank_of = [requester](size_t index) { return index == requester ? 0 : index + 1; };
+    auto index_of = [requester](size_t rank) { return rank == 0 ? requester : rank - 1; };
+    std::unordered_map<int, size_t> index_by_printer_id;
+    free_at_.resize(printers.size());
+    free_printers_.clear();
+    for (size_t index = 0; index < printers.size(); ++index) {
+        const SchedulerPrinter &printer = printers[index];
+        free_at_[index] =
+            std::max<int64_t>(0, printer.busy_seconds) + printer.unestimated_jobs * fallback;
+        free_printers_.emplace(free_at_[index], rank_of(index));
+        index_by_printer_id.emplace(printer.printer_id, index);
+    }
+
+    for (const size_t position : order_) {
+        const SchedulerJob &job = jobs[position];
+        size_t slot = printers.size();
+        if (job.printer_id != 0) {
+            const auto pinned = index_by_printer_id.find(job.printer_id);
+            if (pinned != index_by_printer_id.end() && eligible(job.job_id, job.printer_id)) {
+                slot = pinned->second;
+            }
+        } else {
+            for (const auto &entry : free_printers_) {
+                const size_t candidate = index_of(entry.second);
+                if (eligible(job.job_id, printers[candidate].printer_id)) {
+                    slot = candidate;
+                    break;
+                }
+            }
+        }
+        if (slot == printers.size()) {
+            continue;
+        }
+        if (slot == requester) {
+            return job.job_id;
+        }
+        free_printers_.erase({free_at_[slot], rank_of(slot)});
+        free_at_[slot] += durations_[position];
+        free_printers_.emplace(free_at_[slot], rank_of(slot));
+    }
+    return 0;
+}
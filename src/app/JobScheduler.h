@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <utility>
+#include <vector>
+
+struct SchedulerJob {
+    int job_id = 0;
+    // 0 when any printer may take it.
+    int printer_id = 0;
+    // Negative when the job has no estimate.
+    int64_t estimated_seconds = -1;
+};
+
+struct SchedulerPrinter {
+    int printer_id = 0;
+    // Known time until the printer runs out of work, plus how many of the jobs it
+    // already holds have no estimate and are costed at the queue average.
+    int64_t busy_seconds = 0;
+    int unestimated_jobs = 0;
+};
+
+// Picks jobs for the farm as a whole rather than per printer. Queued jobs are laid
+// out longest first, each on whichever eligible printer frees up soonest (LPT list
+// scheduling), which keeps the last printer to finish close to the others. A
+// printer asking for work takes the first job that layout gives it. Planning stops
+// as soon as that job is known, so a decision over thousands of jobs is one sort.
+class JobScheduler {
+public:
+    // Whether a printer can run a job at all, e.g. has the filament loaded.
+    using Eligibility = std::function<bool(int job_id, int printer_id)>;
+
+    // Returns the id of the job |printer_id| should take next, or 0 if the plan
+    // leaves it nothing because other printers will get to every job sooner.
+    // Each job goes to the soonest free printer that |eligible| accepts.
+    int PickJob(const std::vector<SchedulerJob> &jobs,
+                const std::vector<SchedulerPrinter> &printers,
+                int printer_id,
+                const Eligibility &eligible);
+
+private:
+    std::vector<size_t> order_;
+    std::vector<int64_t> durations_;
+    std::vector<int64_t> free_at_;
+    std::set<std::pair<int64_t, size_t>> free_printers_;
+};
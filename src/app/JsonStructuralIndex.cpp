@@ -0,0 +1,230 @@
+#include "app/JsonStructuralIndex.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BAMBUQUEUE_JSON_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+constexpr size_t kBlockSize = 64;
+constexpr uint64_t kEvenBits = 0x5555555555555555ULL;
+
+struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t op = 0;
+    uint64_t whitespace = 0;
+};
+
+using ClassifyFunction = void (*)(const uint8_t *block, BlockMasks *masks);
+
+enum CharClass : uint8_t {
+    kOther = 0,
+    kQuote = 1,
+    kBackslash = 2,
+    kOp = 4,
+    kWhitespace = 8,
+};
+
+constexpr std::array<uint8_t, 256> BuildClassTable() {
+    std::array<uint8_t, 256> table{};
+    table['"'] = kQuote;
+    table['\\'] = kBackslash;
+    for (const char ch : {'{', '}', '[', ']', ':', ','}) {
+        table[static_cast<uint8_t>(ch)] = kOp;
+    }
+    for (const char ch : {' ', '\t', '\n', '\r'}) {
+        table[static_cast<uint8_t>(ch)] = kWhitespace;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> kClassTable = BuildClassTable();
+
+void ClassifyScalar(const uint8_t *block, BlockMasks *masks) {
+    BlockMasks result;
+    for (size_t index = 0; index < kBlockSize; ++index) {
+        const uint8_t kind = kClassTable[block[index]];
+        const uint64_t bit = 1ULL << index;
+        result.quote |= (kind & kQuote) ? bit : 0;
+        result.backslash |= (kind & kBackslash) ? bit : 0;
+        result.op |= (kind & kOp) ? bit : 0;
+        result.whitespace |= (kind & kWhitespace) ? bit : 0;
+    }
+    *masks = result;
+}
+
+#ifdef BAMBUQUEUE_JSON_X86
+void ClassifySse2(const uint8_t *block, BlockMasks *masks) {
+    BlockMasks result;
+    for (size_t lane = 0; lane < kBlockSize / 16; ++lane) {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + lane * 16));
+        auto match = [&chunk](char ch) { return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(ch)); };
+        const __m128i op =
+            _mm_or_si128(_mm_or_si128(_mm_or_si128(match('{'), match('}')),
+                                      _mm_or_si128(match('['), match(']'))),
+                         _mm_or_si128(match(':'), match(',')));
+        const __m128i whitespace = _mm_or_si128(_mm_or_si128(match(' '), match('\t')),
+                                                _mm_or_si128(match('\n'), match('\r')));
+        const unsigned shift = static_cast<unsigned>(lane * 16);
+        auto bits = [shift](__m128i mask) {
+            return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(mask)))
+                   << shift;
+        };
+        result.quote |= bits(match('"'));
+        result.backslash |= bits(match('\\'));
+        result.op |= bits(op);
+        result.whitespace |= bits(whitespace);
+    }
+    *masks = result;
+}
+
+__attribute__((target("avx2"))) void ClassifyAvx2(const uint8_t *block, BlockMasks *masks) {
+    BlockMasks result;
+    for (size_t lane = 0; lane < kBlockSize / 32; ++lane) {
+        const __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + lane * 32));
+        const __m256i op = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('{')),
+                                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('[')),
+                                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(']')))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(','))));
+        const __m256i whitespace =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                                            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+                                            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+        const unsigned shift = static_cast<unsigned>(lane * 32);
+        result.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')))))
+                        << shift;
+        result.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(
+                                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')))))
+                            << shift;
+        result.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op)))
+                     << shift;
+        result.whitespace |=
+            static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace)))
+            << shift;
+    }
+    *masks = result;
+}
+#endif
+
+struct ClassifierBackend {
+    ClassifyFunction classify;
+    const char *name;
+};
+
+ClassifierBackend SelectBackend() {
+#ifdef BAMBUQUEUE_JSON_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {ClassifyAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {ClassifySse2, "sse2"};
+    }
+#endif
+    return {ClassifyScalar, "scalar"};
+}
+
+const ClassifierBackend &GetBackend() {
+    static const ClassifierBackend backend = SelectBackend();
+    return backend;
+}
+
+// Marks characters preceded by an odd run of backslashes. |carry| is set when
+// the previous block ended in such a run.
+uint64_t FindEscaped(uint64_t backslash, uint64_t *carry) {
+    backslash &= ~*carry;
+    const uint64_t follows_escape = (backslash << 1) | *carry;
+    const uint64_t odd_starts = backslash & ~kEvenBits & ~follows_escape;
+    const uint64_t even_sequences = odd_starts + backslash;
+    *carry = even_sequences < odd_starts ? 1 : 0;
+    const uint64_t invert_mask = even_sequences << 1;
+    return (kEvenBits ^ invert_mask) & follows_escape;
+}
+
+// Bit i of the result is the parity of bits 0..i, i.e. whether a string is open.
+uint64_t PrefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Writes eight positions per step without checking how many bits are left;
+// the buffer carries kBlockSize entries of slack so the overshoot is harmless.
+uint32_t *AppendPositions(uint64_t bits, uint32_t base, uint32_t *out) {
+    const int count = __builtin_popcountll(bits);
+    uint32_t *const end = out + count;
+    while (out < end) {
+        for (int lane = 0; lane < 8; ++lane) {
+            out[lane] = base + static_cast<uint32_t>(__builtin_ctzll(bits | (1ULL << 63)));
+            bits &= bits - 1;
+        }
+        out += 8;
+    }
+    return end;
+}
+}  // namespace
+
+bool JsonStructuralIndex::Build(std::string_view input) {
+    const size_t required = input.size() + kBlockSize;
+    if (required > capacity_) {
+        positions_.reset(new uint32_t[required]);
+        capacity_ = required;
+    }
+    count_ = 0;
+    const ClassifyFunction classify = GetBackend().classify;
+    const auto *data = reinterpret_cast<const uint8_t *>(input.data());
+    uint32_t *out = positions_.get();
+
+    uint64_t backslashes = 0;
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = 0;
+    uint64_t scalar_carry = 0;
+    uint8_t tail[kBlockSize];
+    for (size_t offset = 0; offset < input.size(); offset += kBlockSize) {
+        const uint8_t *block = data + offset;
+        const size_t length = std::min(kBlockSize, input.size() - offset);
+        if (length < kBlockSize) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, length);
+            block = tail;
+        }
+        BlockMasks masks;
+        classify(block, &masks);
+        backslashes |= masks.backslash;
+
+        const uint64_t quote = masks.quote & ~FindEscaped(masks.backslash, &escape_carry);
+        const uint64_t in_string = PrefixXor(quote) ^ in_string_carry;
+        in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        const uint64_t scalar = ~(masks.op | masks.whitespace | quote);
+        const uint64_t scalar_start = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+
+        const uint64_t structural = ((masks.op | scalar_start) & ~(in_string | quote)) | quote;
+        out = AppendPositions(structural, static_cast<uint32_t>(offset), out);
+    }
+    count_ = static_cast<size_t>(out - positions_.get());
+    has_backslash_ = backslashes != 0;
+    return in_string_carry == 0;
+}
+
+const char *JsonStructuralIndex::Backend() {
+    return GetBackend().name;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// First pass over a JSON document, in the style of simdjson's stage 1. Records
+// the offset of every structural character ({ } [ ] : ,) outside strings, of
+// every unescaped quote, and of the first byte of every number or literal, so
+// that a tokenizer can jump between tokens instead of scanning each byte.
+// Blocks of 64 bytes are classified with AVX2 or SSE2 where the CPU has them
+// and with a lookup table otherwise. The buffer is kept between builds.
+class JsonStructuralIndex {
+public:
+    // Returns false if the input ends inside a string.
+    bool Build(std::string_view input);
+
+    size_t size() const { return count_; }
+    uint32_t operator[](size_t index) const { return positions_[index]; }
+    // True if the input contained a backslash anywhere.
+    bool HasBackslash() const { return has_backslash_; }
+
+    // Name of the block classifier picked for this CPU: "avx2", "sse2" or "scalar".
+    static const char *Backend();
+
+private:
+    std::unique_ptr<uint32_t[]> positions_;
+    size_t capacity_ = 0;
+    size_t count_ = 0;
+    bool has_backslash_ = false;
+};
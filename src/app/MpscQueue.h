@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+// Unbounded multi-producer, single-consumer queue after Dmitry Vyukov's
+// node-based MPSC design. Push is one atomic exchange and never blocks, so any
+// number of reader and worker threads can feed one consumer. The consumer only
+// touches the mutex when the queue has run dry and it is about to sleep.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        while (tail_) {
+            Node *next = tail_->next.load(std::memory_order_relaxed);
+            delete tail_;
+            tail_ = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void Push(T value) {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *previous = head_.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_seq_cst);
+        if (consumer_waiting_.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            wake_.notify_one();
+        }
+    }
+
+    // Consumer only. A push that has swapped the head but not yet linked its node
+    // reads as empty for that instant; WaitPop is woken once the link lands.
+    bool TryPop(T *value) {
+        Node *next = tail_->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        *value = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+    // Consumer only. Returns false if |timeout| passed or Wake was called first.
+    bool WaitPop(T *value, std::chrono::milliseconds timeout) {
+        if (TryPop(value)) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        consumer_waiting_.store(true, std::memory_order_seq_cst);
+        const bool ready = wake_.wait_for(lock, timeout, [this]() {
+            return woken_ || tail_->next.load(std::memory_order_seq_cst) != nullptr;
+        });
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+        woken_ = false;
+        return ready && TryPop(value);
+    }
+
+    // Interrupts a WaitPop in progress, or the next one to start.
+    void Wake() {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        woken_ = true;
+        wake_.notify_one();
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node *> head_;
+    Node *tail_;
+    std::atomic<bool> consumer_waiting_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool woken_ = false;
+};
@@ -1,10 +1,31 @@
 #include "app/MqttClient.h"
 
+#include "app/StringUtil.h"
+
 #include <wx/log.h>
-#include <wx/txtstrm.h>
-#include <wx/utils.h>
 
-MqttClient::MqttClient() = default;
+#include <algorithm>
+
+namespace {
+constexpr int kMqttPort = 8883;
+constexpr auto kWriteTimeout = std::chrono::seconds(5);
+// A session that falls this far behind is treated like a failed write.
+constexpr size_t kMaxOutboxBytes = 1 << 20;
+constexpr uint16_t kKeepAliveSeconds = 60;
+constexpr char kMqttUsername[] = "bblp";
+constexpr auto kConnectTimeout = std::chrono::seconds(10);
+constexpr auto kInitialBackoff = std::chrono::milliseconds(500);
+constexpr auto kMaxBackoff = std::chrono::milliseconds(30000);
+constexpr unsigned int kMaxBackoffDoublings = 6;
+
+std::string BuildClientId(std::mt19937 *generator) {
+    std::uniform_int_distribution<unsigned int> distribution(0, 0xFFFFFF);
+    return wxString::Format("bambuqueue_%06x", distribution(*generator)).ToStdString();
+}
+}  // namespace
+
+MqttClient::MqttClient()
+    : port_(kMqttPort), use_tls_(true), username_(kMqttUsername), jitter_(std::random_device{}()) {}
 
 MqttClient::~MqttClient() {
     Stop();
@@ -13,9 +34,9 @@ MqttClient::~MqttClient() {
 bool MqttClient::Publish(const wxString &host,
                          const wxString &access_code,
                          const wxString &topic,
-                         const wxString &payload,
+                         std::string_view payload,
                          wxString *error_message) {
-    if (host.empty() || access_code.empty() || topic.empty()) {
+    if (host.empty() || topic.empty() || (access_code.empty() && username_ == kMqttUsername)) {
         if (error_message) {
             *error_message = "MQTT publish failed: missing host, access code, or topic.";
         }
@@ -23,34 +44,28 @@ bool MqttClient::Publish(const wxString &host,
         return false;
     }
 
-    wxArrayString args;
-    args.Add("mosquitto_pub");
-    args.Add("-h");
-    args.Add(host);
-    args.Add("-p");
-    args.Add("8883");
-    args.Add("--tls-version");
-    args.Add("tlsv1.2");
-    args.Add("--insecure");
-    args.Add("-u");
-    args.Add("bblp");
-    args.Add("-P");
-    args.Add(access_code);
-    args.Add("-t");
-    args.Add(topic);
-    args.Add("-m");
-    args.Add(payload);
-
-    const long result = wxExecute(args, wxEXEC_SYNC);
-    if (result != 0) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    if (state_ != SessionState::Connected || host_ != host) {
         if (error_message) {
-            *error_message = "MQTT publish failed: mosquitto_pub exited with error.";
+            *error_message =
+                wxString::Format("MQTT publish failed: no active session to %s.", host);
         }
-        wxLogError("MqttClient: mosquitto_pub exited with code %ld", result);
+        wxLogWarning("MqttClient: publish to %s skipped, session to %s is not connected.",
+                     topic,
+                     host);
         return false;
     }
 
-    wxLogMessage("MqttClient: published to %s", topic);
+    wxString send_error;
+    if (!SendPacket(EncodeMqttPublish(ToUtf8(topic), payload), &send_error)) {
+        if (error_message) {
+            *error_message = "MQTT publish failed: " + send_error;
+        }
+        wxLogError("MqttClient: publish to %s failed: %s", topic, send_error);
+        return false;
+    }
+
+    wxLogDebug("MqttClient: published to %s", topic);
     return true;
 }
 
@@ -59,9 +74,25 @@ bool MqttClient::Subscribe(const wxString &host,
                            const wxString &topic,
                            MessageHandler handler,
                            wxString *error_message) {
+    RawMessageHandler raw_handler;
+    if (handler) {
+        raw_handler = [handler = std::move(handler)](std::string_view message_topic,
+                                                     std::string_view payload) {
+            handler(wxString::FromUTF8(message_topic.data(), message_topic.size()),
+                    wxString::FromUTF8(payload.data(), payload.size()));
+        };
+    }
+    return Subscribe(host, access_code, topic, std::move(raw_handler), error_message);
+}
+
+bool MqttClient::Subscribe(const wxString &host,
+                           const wxString &access_code,
+                           const wxString &topic,
+                           RawMessageHandler handler,
+                           wxString *error_message) {
     Stop();
 
-    if (host.empty() || access_code.empty() || topic.empty()) {
+    if (host.empty() || topic.empty() || (access_code.empty() && username_ == kMqttUsername)) {
         if (error_message) {
             *error_message = "MQTT subscribe failed: missing host, access code, or topic.";
         }
@@ -69,79 +100,378 @@ bool MqttClient::Subscribe(const wxString &host,
         return false;
     }
 
-    process_ = std::make_unique<wxProcess>();
-    process_->Redirect();
-
-    wxArrayString args;
-    args.Add("mosquitto_sub");
-    args.Add("-h");
-    args.Add(host);
-    args.Add("-p");
-    args.Add("8883");
-    args.Add("--tls-version");
-    args.Add("tlsv1.2");
-    args.Add("--insecure");
-    args.Add("-u");
-    args.Add("bblp");
-    args.Add("-P");
-    args.Add(access_code);
-    args.Add("-t");
-    args.Add(topic);
-    args.Add("-v");
-
-    const long pid = wxExecute(args, wxEXEC_ASYNC, process_.get());
-    if (pid == 0) {
-        if (error_message) {
-            *error_message = "MQTT subscribe failed: unable to start mosquitto_sub.";
+    if (!reactor_) {
+        owned_reactor_ = std::make_unique<MqttReactor>(1);
+        if (!owned_reactor_->Start(error_message)) {
+            owned_reactor_.reset();
+            return false;
         }
-        wxLogError("MqttClient: mosquitto_sub failed to start.");
-        process_.reset();
-        return false;
+        reactor_ = owned_reactor_.get();
     }
 
-    stop_ = false;
-    reader_thread_ = std::thread(&MqttClient::ReaderLoop, this, std::move(handler));
-    wxLogMessage("MqttClient: subscribed to %s (pid %ld)", topic, pid);
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        host_ = host;
+        access_code_ = access_code;
+        topic_ = topic;
+        handler_ = std::move(handler);
+        failed_attempts_ = 0;
+        next_attempt_ = std::chrono::steady_clock::now() + start_delay_;
+        state_ = SessionState::Waiting;
+    }
+
+    if (!reactor_->Attach(this, error_message)) {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        state_ = SessionState::Idle;
+        return false;
+    }
+    wxLogMessage("MqttClient: subscribing to %s on %s", topic, host);
     return true;
 }
 
 void MqttClient::Stop() {
-    stop_ = true;
-    if (process_) {
-        wxProcess::Kill(process_->GetPid(), wxSIGTERM, wxKILL_CHILDREN);
+    if (reactor_) {
+        reactor_->Detach(this);
     }
-    if (reader_thread_.joinable()) {
-        reader_thread_.join();
+
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    if (state_ == SessionState::Connected) {
+        SendPacket(EncodeMqttDisconnect(), nullptr);
     }
-    process_.reset();
+    socket_.Close();
+    ResetOutbox();
+    state_ = SessionState::Idle;
 }
 
-void MqttClient::ReaderLoop(MessageHandler handler) {
-    if (!process_ || !process_->IsInputOpened()) {
-        return;
+void MqttClient::SetReactor(MqttReactor *reactor) {
+    Stop();
+    reactor_ = reactor ? reactor : owned_reactor_.get();
+}
+
+void MqttClient::SetConnectionHandler(ConnectionHandler handler) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    connection_handler_ = std::move(handler);
+}
+
+void MqttClient::SetStartDelay(std::chrono::milliseconds delay) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    start_delay_ = delay;
+}
+
+void MqttClient::SetEndpoint(int port, bool use_tls, const wxString &username) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    port_ = port;
+    use_tls_ = use_tls;
+    username_ = username;
+}
+
+bool MqttClient::IsConnected() const {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    return state_ == SessionState::Connected;
+}
+
+void MqttClient::BeginConnect(std::chrono::steady_clock::time_point now) {
+    wxString connect_error;
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        connect_started_ = now;
+        last_read_ = now;
+        if (socket_.BeginConnect(host_, port_, use_tls_, &connect_error)) {
+            frame_reader_.Reset();
+            ResetOutbox();
+            state_ = SessionState::Connecting;
+            write_interest_ = true;
+            if (reactor_->WatchSocket(this, socket_.GetFd(), true)) {
+                return;
+            }
+            connect_error = "unable to register socket with the reactor.";
+        }
     }
+    HandleConnectionLost(connect_error);
+}
 
-    wxInputStream *stream = process_->GetInputStream();
-    wxTextInputStream text(*stream);
+bool MqttClient::ContinueConnect(wxString *error_message) {
+    bool want_write = false;
+    const TlsConnectStatus status = socket_.ContinueConnect(&want_write, error_message);
+    if (status == TlsConnectStatus::InProgress) {
+        reactor_->SetWriteInterest(this, socket_.GetFd(), want_write);
+        write_interest_ = want_write;
+        return true;
+    }
+    if (status == TlsConnectStatus::Failed) {
+        return false;
+    }
 
-    while (!stop_) {
-        if (!stream->CanRead()) {
-            wxMilliSleep(100);
-            continue;
+    reactor_->SetWriteInterest(this, socket_.GetFd(), false);
+    write_interest_ = false;
+    MqttConnectOptions options;
+    options.client_id = BuildClientId(&jitter_);
+    options.username = ToUtf8(username_);
+    options.password = ToUtf8(access_code_);
+    options.keep_alive_seconds = kKeepAliveSeconds;
+    if (!SendPacket(EncodeMqttConnect(options), error_message)) {
+        return false;
+    }
+    state_ = SessionState::AwaitingConnack;
+    if (socket_.SessionReused()) {
+        wxLogMessage("MqttClient: resumed TLS session with %s", host_);
+    }
+    return true;
+}
+
+void MqttClient::HandleConnectionLost(const wxString &reason) {
+    bool was_connected = false;
+    ConnectionHandler connection_handler;
+    std::chrono::milliseconds delay{0};
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        if (state_ == SessionState::Idle) {
+            return;
         }
+        was_connected = state_ == SessionState::Connected;
+        reactor_->UnwatchSocket(this, socket_.GetFd());
+        socket_.Close();
+        ResetOutbox();
+        delay = NextBackoff();
+        next_attempt_ = std::chrono::steady_clock::now() + delay;
+        state_ = SessionState::Waiting;
+        connection_handler = connection_handler_;
+    }
 
-        wxString line = text.ReadLine();
-        if (line.empty()) {
-            continue;
+    wxLogWarning("MqttClient: session to %s lost (%s), reconnecting in %lld ms",
+                 host_,
+                 reason,
+                 static_cast<long long>(delay.count()));
+    if (was_connected && connection_handler) {
+        connection_handler(false);
+    }
+}
+
+// Full jitter: a uniform delay up to the doubled ceiling, so printers that lost
+// their sessions together spread their reconnects over the whole window.
+std::chrono::milliseconds MqttClient::NextBackoff() {
+    const unsigned int doublings = std::min(failed_attempts_, kMaxBackoffDoublings);
+    const std::chrono::milliseconds ceiling =
+        std::min<std::chrono::milliseconds>(kMaxBackoff, kInitialBackoff * (1 << doublings));
+    failed_attempts_ += 1;
+    std::uniform_int_distribution<long long> distribution(0, ceiling.count());
+    return std::chrono::milliseconds(distribution(jitter_));
+}
+
+// Callers hold io_mutex_. The packet is queued behind anything still unsent and
+// as much as the socket takes right away is written; nothing here blocks.
+bool MqttClient::SendPacket(const std::string &packet, wxString *error_message) {
+    if (outbox_.size() - outbox_offset_ + packet.size() > kMaxOutboxBytes) {
+        if (error_message) {
+            *error_message = "send buffer is full.";
+        }
+        return false;
+    }
+    if (outbox_offset_ == outbox_.size()) {
+        outbox_.clear();
+        outbox_offset_ = 0;
+        outbox_progress_ = std::chrono::steady_clock::now();
+    }
+    outbox_.append(packet);
+    return FlushOutbox(error_message);
+}
+
+bool MqttClient::FlushOutbox(wxString *error_message) {
+    while (outbox_offset_ < outbox_.size()) {
+        const long bytes =
+            socket_.WriteSome(outbox_.data() + outbox_offset_, outbox_.size() - outbox_offset_);
+        if (bytes < 0) {
+            if (error_message) {
+                *error_message = "connection failed while writing.";
+            }
+            return false;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        outbox_offset_ += static_cast<size_t>(bytes);
+        last_write_ = std::chrono::steady_clock::now();
+        outbox_progress_ = last_write_;
+    }
+    const bool pending = outbox_offset_ < outbox_.size();
+    if (!pending) {
+        outbox_.clear();
+        outbox_offset_ = 0;
+    }
+    if (pending != write_interest_) {
+        reactor_->SetWriteInterest(this, socket_.GetFd(), pending);
+        write_interest_ = pending;
+    }
+    return true;
+}
+
+void MqttClient::ResetOutbox() {
+    outbox_.clear();
+    outbox_offset_ = 0;
+    write_interest_ = false;
+}
+
+bool MqttClient::ReadAvailable(bool *drained) {
+    *drained = false;
+    while (true) {
+        size_t writable = 0;
+        char *region = frame_reader_.WritableRegion(&writable);
+        const long bytes = socket_.Read(region, writable);
+        if (bytes < 0) {
+            return false;
+        }
+        if (bytes == 0) {
+            *drained = true;
+            return true;
+        }
+        last_read_ = std::chrono::steady_clock::now();
+        frame_reader_.Commit(static_cast<size_t>(bytes));
+        if (static_cast<size_t>(bytes) == writable) {
+            return true;
         }
+    }
+}
 
-        const int split = line.Find(' ');
-        if (split == wxNOT_FOUND) {
+bool MqttClient::DispatchFrames() {
+    MqttPacket packet;
+    MqttPublishView publish;
+    bool malformed = false;
+    while (frame_reader_.Next(&packet, &malformed)) {
+        if (packet.type == MqttPacketType::Publish) {
+            if (!DecodeMqttPublish(packet, &publish)) {
+                continue;
+            }
+            if (publish.qos > 0) {
+                std::lock_guard<std::mutex> lock(io_mutex_);
+                SendPacket(EncodeMqttPuback(publish.packet_id), nullptr);
+            }
+            if (handler_) {
+                handler_(publish.topic, publish.payload);
+            }
             continue;
         }
 
-        wxString topic = line.SubString(0, split - 1);
-        wxString payload = line.SubString(split + 1, line.length() - 1);
-        handler(topic, payload);
+        ConnectionHandler connected_handler;
+        {
+            std::lock_guard<std::mutex> lock(io_mutex_);
+            if (packet.type == MqttPacketType::Connack &&
+                state_ == SessionState::AwaitingConnack) {
+                uint8_t return_code = 0xFF;
+                if (!DecodeMqttConnack(packet, &return_code) || return_code != 0) {
+                    wxLogError("MqttClient: %s refused connection (code %d)",
+                               host_,
+                               static_cast<int>(return_code));
+                    return false;
+                }
+                if (!SendPacket(EncodeMqttSubscribe(next_packet_id_++, ToUtf8(topic_), 0),
+                                nullptr)) {
+                    return false;
+                }
+                state_ = SessionState::AwaitingSuback;
+            } else if (packet.type == MqttPacketType::Suback &&
+                       state_ == SessionState::AwaitingSuback) {
+                if (packet.body.size() < 3 || static_cast<uint8_t>(packet.body[2]) == 0x80) {
+                    wxLogError("MqttClient: %s rejected subscription to %s", host_, topic_);
+                    return false;
+                }
+                state_ = SessionState::Connected;
+                failed_attempts_ = 0;
+                connected_handler = connection_handler_;
+                wxLogMessage("MqttClient: subscribed to %s on %s", topic_, host_);
+            }
+        }
+        if (connected_handler) {
+            connected_handler(true);
+        }
+    }
+    if (malformed) {
+        wxLogError("MqttClient: malformed packet from %s", host_);
+        return false;
+    }
+    return true;
+}
+
+void MqttClient::ProcessIo() {
+    bool alive = true;
+    bool drained = true;
+    wxString io_error;
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        if (state_ == SessionState::Idle || state_ == SessionState::Waiting) {
+            return;
+        }
+        if (state_ == SessionState::Connecting) {
+            if (!ContinueConnect(&io_error)) {
+                if (io_error.empty()) {
+                    io_error = "TLS connect failed.";
+                }
+            } else if (state_ == SessionState::Connecting) {
+                return;
+            }
+        }
+        if (io_error.empty() && outbox_offset_ < outbox_.size()) {
+            FlushOutbox(&io_error);
+        }
+        if (io_error.empty()) {
+            alive = ReadAvailable(&drained);
+        }
+    }
+
+    if (!io_error.empty()) {
+        HandleConnectionLost(io_error);
+        return;
+    }
+    while (true) {
+        if (!DispatchFrames()) {
+            HandleConnectionLost("protocol error");
+            return;
+        }
+        if (!alive) {
+            HandleConnectionLost("connection closed");
+            return;
+        }
+        if (drained) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        if (state_ == SessionState::Idle || state_ == SessionState::Waiting) {
+            return;
+        }
+        alive = ReadAvailable(&drained);
+    }
+}
+
+void MqttClient::ProcessTimers(std::chrono::steady_clock::time_point now) {
+    SessionState state = SessionState::Idle;
+    bool keepalive_expired = false;
+    bool write_stalled = false;
+    bool attempt_due = false;
+    bool connect_expired = false;
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        state = state_;
+        write_stalled = outbox_offset_ < outbox_.size() && now - outbox_progress_ > kWriteTimeout;
+        if (state == SessionState::Connected) {
+            if (now - last_read_ > std::chrono::seconds(kKeepAliveSeconds) * 3 / 2) {
+                keepalive_expired = true;
+            } else if (now - last_write_ >= std::chrono::seconds(kKeepAliveSeconds / 2)) {
+                SendPacket(EncodeMqttPingreq(), nullptr);
+            }
+        }
+        attempt_due = state == SessionState::Waiting && now >= next_attempt_;
+        connect_expired = (state == SessionState::Connecting ||
+                           state == SessionState::AwaitingConnack ||
+                           state == SessionState::AwaitingSuback) &&
+                          now - connect_started_ > kConnectTimeout;
+    }
+
+    if (keepalive_expired) {
+        HandleConnectionLost("keepalive timeout");
+    } else if (write_stalled) {
+        HandleConnectionLost("write timed out");
+    } else if (connect_expired) {
+        HandleConnectionLost("connect timed out");
+    } else if (attempt_due) {
+        BeginConnect(now);
     }
 }
@@ -1,36 +1,110 @@
 #pragma once
 
-#include <wx/process.h>
+#include "app/MqttPacket.h"
+#include "app/MqttReactor.h"
+#include "app/TlsSocket.h"
+
 #include <wx/string.h>
 
-#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <thread>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
 
 class MqttClient {
 public:
     using MessageHandler = std::function<void(const wxString &topic, const wxString &payload)>;
+    // Topic and payload are UTF-8 views into the client's receive buffer and are only
+    // valid for the duration of the call.
+    using RawMessageHandler = std::function<void(std::string_view topic, std::string_view payload)>;
+    using ConnectionHandler = std::function<void(bool connected)>;
 
     MqttClient();
     ~MqttClient();
 
+    // |payload| is UTF-8 and is sent without conversion.
     bool Publish(const wxString &host,
                  const wxString &access_code,
                  const wxString &topic,
-                 const wxString &payload,
+                 std::string_view payload,
                  wxString *error_message);
     bool Subscribe(const wxString &host,
                    const wxString &access_code,
                    const wxString &topic,
                    MessageHandler handler,
                    wxString *error_message);
+    bool Subscribe(const wxString &host,
+                   const wxString &access_code,
+                   const wxString &topic,
+                   RawMessageHandler handler,
+                   wxString *error_message);
     void Stop();
+    void SetReactor(MqttReactor *reactor);
+    void SetConnectionHandler(ConnectionHandler handler);
+    void SetStartDelay(std::chrono::milliseconds delay);
+    // Defaults to the printer's own broker: TLS on 8883 as user bblp with the access
+    // code as password. Other brokers may use plain TCP or no credentials.
+    void SetEndpoint(int port, bool use_tls, const wxString &username);
+    bool IsConnected() const;
 
 private:
-    void ReaderLoop(MessageHandler handler);
+    friend class MqttReactor;
+
+    enum class SessionState {
+        Idle,
+        Waiting,
+        Connecting,
+        AwaitingConnack,
+        AwaitingSuback,
+        Connected,
+    };
+
+    void BeginConnect(std::chrono::steady_clock::time_point now);
+    bool ContinueConnect(wxString *error_message);
+    void HandleConnectionLost(const wxString &reason);
+    std::chrono::milliseconds NextBackoff();
+    bool SendPacket(const std::string &packet, wxString *error_message);
+    bool FlushOutbox(wxString *error_message);
+    void ResetOutbox();
+    bool ReadAvailable(bool *drained);
+    bool DispatchFrames();
+    void ProcessIo();
+    void ProcessTimers(std::chrono::steady_clock::time_point now);
 
-    std::unique_ptr<wxProcess> process_;
-    std::thread reader_thread_;
-    std::atomic<bool> stop_{false};
+    TlsSocket socket_;
+    MqttFrameReader frame_reader_;
+    // Held only for non-blocking socket calls, so a slow peer never holds up the
+    // reactor's other connections.
+    mutable std::mutex io_mutex_;
+    // Encoded packets the socket has not taken yet; the reactor writes the rest
+    // out once the socket is writable.
+    std::string outbox_;
+    size_t outbox_offset_ = 0;
+    bool write_interest_ = false;
+    SessionState state_ = SessionState::Idle;
+    RawMessageHandler handler_;
+    ConnectionHandler connection_handler_;
+    MqttReactor *reactor_ = nullptr;
+    std::unique_ptr<MqttReactor> owned_reactor_;
+    wxString host_;
+    int port_;
+    bool use_tls_;
+    wxString username_;
+    wxString access_code_;
+    wxString topic_;
+    uint16_t next_packet_id_ = 1;
+    std::chrono::milliseconds start_delay_{0};
+    unsigned int failed_attempts_ = 0;
+    std::mt19937 jitter_;
+    std::chrono::steady_clock::time_point next_attempt_;
+    std::chrono::steady_clock::time_point connect_started_;
+    std::chrono::steady_clock::time_point last_write_;
+    // Last time the socket took bytes while the outbox was non-empty.
+    std::chrono::steady_clock::time_point outbox_progress_;
+    std::chrono::steady_clock::time_point last_read_;
 };
@@ -0,0 +1,381 @@
+#include "app/MqttPacket.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint32_t kMaxRemainingLength = 268435455;
+constexpr size_t kInitialRingCapacity = 64 * 1024;
+constexpr size_t kMaxFrameSize = 16 * 1024 * 1024;
+constexpr uint8_t kProtocolLevel311 = 4;
+constexpr uint8_t kConnectFlagCleanSession = 0x02;
+constexpr uint8_t kConnectFlagPassword = 0x40;
+constexpr uint8_t kConnectFlagUsername = 0x80;
+
+void AppendUint16(std::string *out, uint16_t value) {
+    out->push_back(static_cast<char>((value >> 8) & 0xFF));
+    out->push_back(static_cast<char>(value & 0xFF));
+}
+
+void AppendString(std::string *out, std::string_view value) {
+    AppendUint16(out, static_cast<uint16_t>(value.size()));
+    out->append(value);
+}
+
+void AppendRemainingLength(std::string *out, size_t length) {
+    do {
+        uint8_t encoded = static_cast<uint8_t>(length % 128);
+        length /= 128;
+        if (length > 0) {
+            encoded |= 0x80;
+        }
+        out->push_back(static_cast<char>(encoded));
+    } while (length > 0);
+}
+
+std::string BuildPacket(uint8_t header, const std::string &body) {
+    std::string packet;
+    packet.reserve(body.size() + 5);
+    packet.push_back(static_cast<char>(header));
+    AppendRemainingLength(&packet, body.size());
+    packet.append(body);
+    return packet;
+}
+
+uint16_t ReadUint16(std::string_view data, size_t pos) {
+    return static_cast<uint16_t>((static_cast<uint8_t>(data[pos]) << 8) |
+                                 static_cast<uint8_t>(data[pos + 1]));
+}
+
+bool ReadString(std::string_view data, size_t *pos, std::string *out) {
+    if (*pos + 2 > data.size()) {
+        return false;
+    }
+    const size_t length = ReadUint16(data, *pos);
+    if (*pos + 2 + length > data.size()) {
+        return false;
+    }
+    out->assign(data.substr(*pos + 2, length));
+    *pos += 2 + length;
+    return true;
+}
+}  // namespace
+
+std::string EncodeMqttConnect(const MqttConnectOptions &options) {
+    std::string body;
+    AppendString(&body, "MQTT");
+    body.push_back(static_cast<char>(kProtocolLevel311));
+
+    uint8_t flags = kConnectFlagCleanSession;
+    if (!options.username.empty()) {
+        flags |= kConnectFlagUsername;
+        if (!options.password.empty()) {
+            flags |= kConnectFlagPassword;
+        }
+    }
+    body.push_back(static_cast<char>(flags));
+    AppendUint16(&body, options.keep_alive_seconds);
+
+    AppendString(&body, options.client_id);
+    if (flags & kConnectFlagUsername) {
+        AppendString(&body, options.username);
+    }
+    if (flags & kConnectFlagPassword) {
+        AppendString(&body, options.password);
+    }
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Connect) << 4, body);
+}
+
+std::string EncodeMqttSubscribe(uint16_t packet_id, const std::string &topic, uint8_t qos) {
+    std::string body;
+    AppendUint16(&body, packet_id);
+    AppendString(&body, topic);
+    body.push_back(static_cast<char>(qos & 0x03));
+    return BuildPacket((static_cast<uint8_t>(MqttPacketType::Subscribe) << 4) | 0x02, body);
+}
+
+std::string EncodeMqttPublish(std::string_view topic, std::string_view payload) {
+    const size_t body_size = topic.size() + payload.size() + 2;
+    std::string packet;
+    packet.reserve(body_size + 5);
+    packet.push_back(static_cast<char>(static_cast<uint8_t>(MqttPacketType::Publish) << 4));
+    AppendRemainingLength(&packet, body_size);
+    AppendString(&packet, topic);
+    packet.append(payload);
+    return packet;
+}
+
+std::string EncodeMqttPuback(uint16_t packet_id) {
+    std::string body;
+    AppendUint16(&body, packet_id);
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Puback) << 4, body);
+}
+
+std::string EncodeMqttPingreq() {
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Pingreq) << 4, std::string());
+}
+
+std::string EncodeMqttDisconnect() {
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Disconnect) << 4, std::string());
+}
+
+std::string EncodeMqttConnack(uint8_t return_code) {
+    std::string body;
+    body.push_back(0);
+    body.push_back(static_cast<char>(return_code));
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Connack) << 4, body);
+}
+
+std::string EncodeMqttSuback(uint16_t packet_id, const std::vector<uint8_t> &granted_qos) {
+    std::string body;
+    AppendUint16(&body, packet_id);
+    for (const uint8_t qos : granted_qos) {
+        body.push_back(static_cast<char>(qos));
+    }
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Suback) << 4, body);
+}
+
+std::string EncodeMqttPingresp() {
+    return BuildPacket(static_cast<uint8_t>(MqttPacketType::Pingresp) << 4, std::string());
+}
+
+bool DecodeMqttPublish(const MqttPacket &packet, MqttPublishView *publish) {
+    if (packet.type != MqttPacketType::Publish || !publish) {
+        return false;
+    }
+    const std::string_view body = packet.body;
+    if (body.size() < 2) {
+        return false;
+    }
+    const size_t topic_length = ReadUint16(body, 0);
+    size_t pos = 2 + topic_length;
+    if (pos > body.size()) {
+        return false;
+    }
+    publish->topic = body.substr(2, topic_length);
+    publish->qos = static_cast<uint8_t>((packet.flags >> 1) & 0x03);
+    publish->packet_id = 0;
+    if (publish->qos > 0) {
+        if (pos + 2 > body.size()) {
+            return false;
+        }
+        publish->packet_id = ReadUint16(body, pos);
+        pos += 2;
+    }
+    publish->payload = body.substr(pos);
+    return true;
+}
+
+bool DecodeMqttConnack(const MqttPacket &packet, uint8_t *return_code) {
+    if (packet.type != MqttPacketType::Connack || packet.body.size() < 2) {
+        return false;
+    }
+    if (return_code) {
+        *return_code = static_cast<uint8_t>(packet.body[1]);
+    }
+    return true;
+}
+
+bool DecodeMqttConnect(const MqttPacket &packet, MqttConnectOptions *options) {
+    if (packet.type != MqttPacketType::Connect || !options) {
+        return false;
+    }
+    const std::string_view body = packet.body;
+    size_t pos = 0;
+    std::string protocol_name;
+    if (!ReadString(body, &pos, &protocol_name) || pos + 4 > body.size()) {
+        return false;
+    }
+    const uint8_t flags = static_cast<uint8_t>(body[pos + 1]);
+    options->keep_alive_seconds = ReadUint16(body, pos + 2);
+    pos += 4;
+    if (!ReadString(body, &pos, &options->client_id)) {
+        return false;
+    }
+    if (flags & 0x04) {
+        std::string will_topic;
+        std::string will_message;
+        if (!ReadString(body, &pos, &will_topic) || !ReadString(body, &pos, &will_message)) {
+            return false;
+        }
+    }
+    options->username.clear();
+    options->password.clear();
+    if ((flags & kConnectFlagUsername) && !ReadString(body, &pos, &options->username)) {
+        return false;
+    }
+    if ((flags & kConnectFlagPassword) && !ReadString(body, &pos, &options->password)) {
+        return false;
+    }
+    return true;
+}
+
+bool DecodeMqttSubscribe(const MqttPacket &packet,
+                         uint16_t *packet_id,
+                         std::vector<std::string> *topics) {
+    if (packet.type != MqttPacketType::Subscribe || packet.body.size() < 2 || !topics) {
+        return false;
+    }
+    const std::string_view body = packet.body;
+    if (packet_id) {
+        *packet_id = ReadUint16(body, 0);
+    }
+    size_t pos = 2;
+    topics->clear();
+    while (pos < body.size()) {
+        std::string topic;
+        if (!ReadString(body, &pos, &topic) || pos >= body.size()) {
+            return false;
+        }
+        ++pos;
+        topics->push_back(std::move(topic));
+    }
+    return !topics->empty();
+}
+
+bool MqttTopicMatches(std::string_view filter, std::string_view topic) {
+    while (true) {
+        const size_t filter_end = filter.find('/');
+        const std::string_view filter_level = filter.substr(0, filter_end);
+        if (filter_level == "#") {
+            return true;
+        }
+        const size_t topic_end = topic.find('/');
+        const std::string_view topic_level = topic.substr(0, topic_end);
+        if (filter_level != "+" && filter_level != topic_level) {
+            return false;
+        }
+        if (filter_end == std::string_view::npos || topic_end == std::string_view::npos) {
+            return filter_end == std::string_view::npos && topic_end == std::string_view::npos;
+        }
+        filter.remove_prefix(filter_end + 1);
+        topic.remove_prefix(topic_end + 1);
+    }
+}
+
+MqttFrameReader::MqttFrameReader() : ring_(kInitialRingCapacity) {}
+
+char *MqttFrameReader::WritableRegion(size_t *size) {
+    Release();
+    if (size_ == 0) {
+        head_ = 0;
+    }
+    if (size_ == ring_.size()) {
+        Grow(ring_.size() * 2);
+    }
+    const size_t tail = (head_ + size_) & (ring_.size() - 1);
+    *size = tail >= head_ ? ring_.size() - tail : head_ - tail;
+    return ring_.data() + tail;
+}
+
+void MqttFrameReader::Commit(size_t size) {
+    size_ += size;
+}
+
+void MqttFrameReader::Append(const char *data, size_t size) {
+    while (size > 0) {
+        size_t writable = 0;
+        char *region = WritableRegion(&writable);
+        const size_t chunk = std::min(writable, size);
+        std::memcpy(region, data, chunk);
+        Commit(chunk);
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+bool MqttFrameReader::Next(MqttPacket *packet, bool *malformed) {
+    if (malformed) {
+        *malformed = false;
+    }
+    Release();
+    if (size_ < 2) {
+        return false;
+    }
+
+    size_t remaining_length = 0;
+    size_t multiplier = 1;
+    size_t header_size = 1;
+    while (true) {
+        if (header_size >= size_) {
+            return false;
+        }
+        const uint8_t encoded = static_cast<uint8_t>(At(header_size));
+        remaining_length += (encoded & 0x7F) * multiplier;
+        ++header_size;
+        if ((encoded & 0x80) == 0) {
+            break;
+        }
+        multiplier *= 128;
+        if (header_size > 4 || remaining_length > kMaxRemainingLength) {
+            if (malformed) {
+                *malformed = true;
+            }
+            return false;
+        }
+    }
+
+    const size_t frame_size = header_size + remaining_length;
+    if (frame_size > kMaxFrameSize) {
+        if (malformed) {
+            *malformed = true;
+        }
+        return false;
+    }
+    if (frame_size > ring_.size()) {
+        Grow(frame_size);
+    }
+    if (size_ < frame_size) {
+        return false;
+    }
+
+    const uint8_t fixed_header = static_cast<uint8_t>(At(0));
+    packet->type = static_cast<MqttPacketType>(fixed_header >> 4);
+    packet->flags = static_cast<uint8_t>(fixed_header & 0x0F);
+    const size_t body_start = (head_ + header_size) & (ring_.size() - 1);
+    const size_t contiguous = ring_.size() - body_start;
+    if (remaining_length <= contiguous) {
+        packet->body = std::string_view(ring_.data() + body_start, remaining_length);
+    } else {
+        scratch_.assign(ring_.data() + body_start, contiguous);
+        scratch_.append(ring_.data(), remaining_length - contiguous);
+        packet->body = scratch_;
+    }
+    pending_release_ = frame_size;
+    return true;
+}
+
+void MqttFrameReader::Reset() {
+    head_ = 0;
+    size_ = 0;
+    pending_release_ = 0;
+}
+
+char MqttFrameReader::At(size_t index) const {
+    return ring_[(head_ + index) & (ring_.size() - 1)];
+}
+
+void MqttFrameReader::Release() {
+    if (pending_release_ == 0) {
+        return;
+    }
+    head_ = (head_ + pending_release_) & (ring_.size() - 1);
+    size_ -= pending_release_;
+    pending_release_ = 0;
+}
+
+void MqttFrameReader::Grow(size_t minimum_capacity) {
+    size_t capacity = ring_.size();
+    while (capacity < minimum_capacity) {
+        capacity *= 2;
+    }
+    if (capacity == ring_.size()) {
+        return;
+    }
+    std::vector<char> grown(capacity);
+    for (size_t i = 0; i < size_; ++i) {
+        grown[i] = At(i);
+    }
+    ring_.swap(grown);
+    head_ = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class MqttPacketType : uint8_t {
+    Connect = 1,
+    Connack = 2,
+    Publish = 3,
+    Puback = 4,
+    Subscribe = 8,
+    Suback = 9,
+    Pingreq = 12,
+    Pingresp = 13,
+    Disconnect = 14,
+};
+
+struct MqttConnectOptions {
+    std::string client_id;
+    std::string username;
+    std::string password;
+    uint16_t keep_alive_seconds = 60;
+};
+
+// Views returned by MqttFrameReader::Next stay valid until the next call to Next,
+// WritableRegion, Append or Reset on the same reader.
+struct MqttPacket {
+    MqttPacketType type = MqttPacketType::Connect;
+    uint8_t flags = 0;
+    std::string_view body;
+};
+
+struct MqttPublishView {
+    std::string_view topic;
+    std::string_view payload;
+    uint8_t qos = 0;
+    uint16_t packet_id = 0;
+};
+
+std::string EncodeMqttConnect(const MqttConnectOptions &options);
+std::string EncodeMqttSubscribe(uint16_t packet_id, const std::string &topic, uint8_t qos);
+std::string EncodeMqttPublish(std::string_view topic, std::string_view payload);
+std::string EncodeMqttPuback(uint16_t packet_id);
+std::string EncodeMqttPingreq();
+std::string EncodeMqttDisconnect();
+std::string EncodeMqttConnack(uint8_t return_code);
+std::string EncodeMqttSuback(uint16_t packet_id, const std::vector<uint8_t> &granted_qos);
+std::string EncodeMqttPingresp();
+
+bool DecodeMqttPublish(const MqttPacket &packet, MqttPublishView *publish);
+bool DecodeMqttConnack(const MqttPacket &packet, uint8_t *return_code);
+bool DecodeMqttConnect(const MqttPacket &packet, MqttConnectOptions *options);
+bool DecodeMqttSubscribe(const MqttPacket &packet,
+                         uint16_t *packet_id,
+                         std::vector<std::string> *topics);
+bool MqttTopicMatches(std::string_view filter, std::string_view topic);
+
+// Power-of-two ring buffer that frames MQTT packets in place. Socket reads land
+// directly in WritableRegion; only frames that wrap around the end of the ring are
+// copied into a scratch buffer.
+class MqttFrameReader {
+public:
+    MqttFrameReader();
+
+    char *WritableRegion(size_t *size);
+    void Commit(size_t size);
+    void Append(const char *data, size_t size);
+    bool Next(MqttPacket *packet, bool *malformed);
+    void Reset();
+
+private:
+    char At(size_t index) const;
+    void Release();
+    void Grow(size_t minimum_capacity);
+
+    std::vector<char> ring_;
+    std::string scratch_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    size_t pending_release_ = 0;
+};
@@ -0,0 +1,303 @@
+#include "app/MqttReactor.h"
+
+#include "app/MqttClient.h"
+
+#include <wx/log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+namespace {
+constexpr int kTickIntervalMs = 250;
+constexpr int kMaxEventsPerWait = 64;
+
+#if defined(__linux__)
+int CreatePoller() {
+    return epoll_create1(EPOLL_CLOEXEC);
+}
+
+bool AddToPoller(int poller_fd, int fd, void *data, bool want_write) {
+    epoll_event event{};
+    event.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.ptr = data;
+    return epoll_ctl(poller_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void UpdatePoller(int poller_fd, int fd, void *data, bool want_write) {
+    epoll_event event{};
+    event.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.ptr = data;
+    epoll_ctl(poller_fd, EPOLL_CTL_MOD, fd, &event);
+}
+
+void RemoveFromPoller(int poller_fd, int fd) {
+    epoll_ctl(poller_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int WaitPoller(int poller_fd, void **ready, int timeout_ms) {
+    epoll_event events[kMaxEventsPerWait];
+    const int count = epoll_wait(poller_fd, events, kMaxEventsPerWait, timeout_ms);
+    for (int index = 0; index < count; ++index) {
+        ready[index] = events[index].data.ptr;
+    }
+    return count;
+}
+#else
+int CreatePoller() {
+    const int fd = kqueue();
+    if (fd >= 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+}
+
+void UpdatePoller(int poller_fd, int fd, void *data, bool want_write) {
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_WRITE, want_write ? EV_ADD : EV_DELETE, 0, 0, data);
+    kevent(poller_fd, &change, 1, nullptr, 0, nullptr);
+}
+
+bool AddToPoller(int poller_fd, int fd, void *data, bool want_write) {
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_READ, EV_ADD, 0, 0, data);
+    if (kevent(poller_fd, &change, 1, nullptr, 0, nullptr) != 0) {
+        return false;
+    }
+    if (want_write) {
+        UpdatePoller(poller_fd, fd, data, true);
+    }
+    return true;
+}
+
+void RemoveFromPoller(int poller_fd, int fd) {
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(poller_fd, changes, 2, nullptr, 0, nullptr);
+}
+
+int WaitPoller(int poller_fd, void **ready, int timeout_ms) {
+    struct kevent events[kMaxEventsPerWait];
+    timespec timeout{timeout_ms / 1000, static_cast<long>(timeout_ms % 1000) * 1000000L};
+    const int count = kevent(poller_fd, nullptr, 0, events, kMaxEventsPerWait, &timeout);
+    for (int index = 0; index < count; ++index) {
+        ready[index] = events[index].udata;
+    }
+    return count;
+}
+#endif
+}  // namespace
+
+MqttReactor::MqttReactor(size_t thread_count) {
+    thread_count = std::max<size_t>(1, thread_count);
+    for (size_t index = 0; index < thread_count; ++index) {
+        loops_.push_back(std::make_unique<Loop>());
+    }
+}
+
+MqttReactor::~MqttReactor() {
+    Stop();
+}
+
+bool MqttReactor::Start(wxString *error_message) {
+    if (started_) {
+        return true;
+    }
+
+    stop_ = false;
+    for (auto &loop : loops_) {
+        loop->poller_fd = CreatePoller();
+        if (loop->poller_fd < 0 || pipe(loop->wake_fds) != 0) {
+            if (error_message) {
+                *error_message = "MQTT reactor failed: unable to create event poller.";
+            }
+            wxLogError("MqttReactor: unable to create event poller.");
+            Stop();
+            return false;
+        }
+        for (int fd : loop->wake_fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        AddToPoller(loop->poller_fd, loop->wake_fds[0], nullptr, false);
+    }
+
+    for (auto &loop : loops_) {
+        loop->thread = std::thread(&MqttReactor::RunLoop, this, loop.get());
+        loop->thread_id = loop->thread.get_id();
+    }
+    started_ = true;
+    wxLogMessage("MqttReactor: started with %zu I/O thread(s)", loops_.size());
+    return true;
+}
+
+void MqttReactor::Stop() {
+    stop_ = true;
+    for (auto &loop : loops_) {
+        if (loop->wake_fds[1] >= 0) {
+            const char wake = 1;
+            if (write(loop->wake_fds[1], &wake, 1) < 0) {
+                wxLogDebug("MqttReactor: wake write failed (errno %d)", errno);
+            }
+        }
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+        CloseLoop(loop.get());
+    }
+    started_ = false;
+}
+
+bool MqttReactor::Attach(MqttClient *client, wxString *error_message) {
+    if (!started_ || !client) {
+        if (error_message) {
+            *error_message = "MQTT reactor failed: reactor is not running.";
+        }
+        return false;
+    }
+
+    Loop *target = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(assignment_mutex_);
+        if (assignments_.count(client) > 0) {
+            return true;
+        }
+        for (auto &loop : loops_) {
+            if (!target || loop->client_count < target->client_count) {
+                target = loop.get();
+            }
+        }
+        target->client_count += 1;
+        assignments_[client] = target;
+    }
+
+    std::unique_lock<std::mutex> lock(target->mutex, std::defer_lock);
+    if (target->thread_id != std::this_thread::get_id()) {
+        lock.lock();
+    }
+    target->clients.insert(client);
+    return true;
+}
+
+void MqttReactor::Detach(MqttClient *client) {
+    Loop *loop = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(assignment_mutex_);
+        auto it = assignments_.find(client);
+        if (it == assignments_.end()) {
+            return;
+        }
+        loop = it->second;
+        loop->client_count -= 1;
+        assignments_.erase(it);
+    }
+
+    std::unique_lock<std::mutex> lock(loop->mutex, std::defer_lock);
+    if (loop->thread_id != std::this_thread::get_id()) {
+        lock.lock();
+    }
+    loop->clients.erase(client);
+}
+
+bool MqttReactor::WatchSocket(MqttClient *client, int fd, bool want_write) {
+    Loop *loop = FindLoop(client);
+    if (!loop || fd < 0) {
+        return false;
+    }
+    if (!AddToPoller(loop->poller_fd, fd, client, want_write)) {
+        wxLogError("MqttReactor: unable to watch socket %d (errno %d)", fd, errno);
+        return false;
+    }
+    return true;
+}
+
+void MqttReactor::UnwatchSocket(MqttClient *client, int fd) {
+    Loop *loop = FindLoop(client);
+    if (loop && fd >= 0) {
+        RemoveFromPoller(loop->poller_fd, fd);
+    }
+}
+
+void MqttReactor::SetWriteInterest(MqttClient *client, int fd, bool want_write) {
+    Loop *loop = FindLoop(client);
+    if (loop && fd >= 0) {
+        UpdatePoller(loop->poller_fd, fd, client, want_write);
+    }
+}
+
+size_t MqttReactor::GetThreadCount() const {
+    return loops_.size();
+}
+
+void MqttReactor::RunLoop(Loop *loop) {
+    void *ready[kMaxEventsPerWait];
+    auto next_tick = std::chrono::steady_clock::now();
+
+    while (!stop_) {
+        const auto now = std::chrono::steady_clock::now();
+        const int timeout_ms = static_cast<int>(std::max<long long>(
+            0,
+            std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - now).count()));
+        const int count = WaitPoller(loop->poller_fd, ready, timeout_ms);
+        if (count < 0 && errno != EINTR) {
+            wxLogError("MqttReactor: event wait failed (errno %d)", errno);
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(loop->mutex);
+        for (int index = 0; index < count; ++index) {
+            if (!ready[index]) {
+                char drain[64];
+                while (read(loop->wake_fds[0], drain, sizeof(drain)) > 0) {
+                }
+                continue;
+            }
+            auto *client = static_cast<MqttClient *>(ready[index]);
+            if (loop->clients.count(client) > 0) {
+                client->ProcessIo();
+            }
+        }
+
+        const auto tick_now = std::chrono::steady_clock::now();
+        if (tick_now >= next_tick) {
+            const std::vector<MqttClient *> clients(loop->clients.begin(), loop->clients.end());
+            for (MqttClient *client : clients) {
+                if (loop->clients.count(client) > 0) {
+                    client->ProcessTimers(tick_now);
+                }
+            }
+            next_tick = tick_now + std::chrono::milliseconds(kTickIntervalMs);
+        }
+    }
+}
+
+MqttReactor::Loop *MqttReactor::FindLoop(MqttClient *client) {
+    std::lock_guard<std::mutex> lock(assignment_mutex_);
+    auto it = assignments_.find(client);
+    return it == assignments_.end() ? nullptr : it->second;
+}
+
+void MqttReactor::CloseLoop(Loop *loop) {
+    for (int &fd : loop->wake_fds) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (loop->poller_fd >= 0) {
+        close(loop->poller_fd);
+        loop->poller_fd = -1;
+    }
+    loop->thread_id = std::thread::id();
+}
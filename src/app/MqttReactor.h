@@ -0,0 +1,53 @@
+#pragma once
+
+#include <wx/string.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class MqttClient;
+
+class MqttReactor {
+public:
+    explicit MqttReactor(size_t thread_count);
+    ~MqttReactor();
+
+    MqttReactor(const MqttReactor &) = delete;
+    MqttReactor &operator=(const MqttReactor &) = delete;
+
+    bool Start(wxString *error_message);
+    void Stop();
+    bool Attach(MqttClient *client, wxString *error_message);
+    void Detach(MqttClient *client);
+    bool WatchSocket(MqttClient *client, int fd, bool want_write);
+    void UnwatchSocket(MqttClient *client, int fd);
+    void SetWriteInterest(MqttClient *client, int fd, bool want_write);
+    size_t GetThreadCount() const;
+
+private:
+    struct Loop {
+        int poller_fd = -1;
+        int wake_fds[2] = {-1, -1};
+        std::thread thread;
+        std::thread::id thread_id;
+        std::mutex mutex;
+        std::unordered_set<MqttClient *> clients;
+        size_t client_count = 0;
+    };
+
+    void RunLoop(Loop *loop);
+    void CloseLoop(Loop *loop);
+    Loop *FindLoop(MqttClient *client);
+
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::mutex assignment_mutex_;
+    std::unordered_map<MqttClient *, Loop *> assignments_;
+    std::atomic<bool> stop_{false};
+    bool started_ = false;
+};
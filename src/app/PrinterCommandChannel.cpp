@@ -0,0 +1,267 @@
+#include "app/PrinterCommandChannel.h"
+
+#include <wx/log.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+constexpr size_t kInFlightWindow = 4;
+constexpr size_t kMaxQueuedCommands = 64;
+constexpr size_t kControlInFlightWindow = 4;
+constexpr size_t kMaxQueuedControlCommands = 16;
+constexpr auto kCommandTimeout = std::chrono::seconds(15);
+constexpr double kLatencySmoothing = 0.2;
+
+std::atomic<uint64_t> g_next_sequence_id{20000000};
+
+double ToMilliseconds(std::chrono::microseconds latency) {
+    return static_cast<double>(latency.count()) / 1000.0;
+}
+
+void RecordLatency(CommandLatencyStats *stats, double latency_ms) {
+    const uint64_t samples = stats->acknowledged + stats->rejected;
+    stats->last_ms = latency_ms;
+    stats->max_ms = std::max(stats->max_ms, latency_ms);
+    stats->average_ms = samples <= 1 ? latency_ms
+                                     : stats->average_ms +
+                                           kLatencySmoothing * (latency_ms - stats->average_ms);
+}
+
+void RecordStatus(CommandLatencyStats *stats, CommandStatus status, double latency_ms) {
+    if (status == CommandStatus::TimedOut) {
+        stats->timed_out += 1;
+        return;
+    }
+    if (status == CommandStatus::Acknowledged) {
+        stats->acknowledged += 1;
+    } else {
+        stats->rejected += 1;
+    }
+    RecordLatency(stats, latency_ms);
+}
+}  // namespace
+
+void PrinterCommandChannel::SetPublisher(Publisher publisher) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publisher_ = std::move(publisher);
+}
+
+uint64_t PrinterCommandChannel::NextSequenceId() {
+    return g_next_sequence_id.fetch_add(1);
+}
+
+bool PrinterCommandChannel::Send(const wxString &command,
+                                 uint64_t sequence_id,
+                                 std::string payload,
+                                 CompletionHandler handler,
+                                 wxString *error_message) {
+    PendingCommand pending;
+    pending.command = command;
+    pending.sequence_id = sequence_id;
+    pending.payload = std::move(payload);
+    pending.handler = std::move(handler);
+    return Submit(std::move(pending), error_message);
+}
+
+bool PrinterCommandChannel::SendControl(const wxString &command,
+                                        uint64_t sequence_id,
+                                        std::string payload,
+                                        CompletionHandler handler,
+                                        wxString *error_message) {
+    PendingCommand pending;
+    pending.command = command;
+    pending.sequence_id = sequence_id;
+    pending.priority = CommandPriority::Control;
+    pending.payload = std::move(payload);
+    pending.handler = std::move(handler);
+    return Submit(std::move(pending), error_message);
+}
+
+bool PrinterCommandChannel::Submit(PendingCommand pending, wxString *error_message) {
+    pending.issued_at = std::chrono::steady_clock::now();
+    const bool control = pending.priority == CommandPriority::Control;
+    const size_t window = control ? kControlInFlightWindow : kInFlightWindow;
+    const size_t max_queued = control ? kMaxQueuedControlCommands : kMaxQueuedCommands;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::deque<PendingCommand> &queue = control ? control_queued_ : queued_;
+    const size_t in_flight = control ? control_in_flight_ : bulk_in_flight_;
+    if (in_flight >= window) {
+        if (queue.size() >= max_queued) {
+            if (error_message) {
+                *error_message = wxString::Format(
+                    "Command %s rejected: %zu commands already waiting for the printer.",
+                    pending.command,
+                    queue.size());
+            }
+            return false;
+        }
+        queue.push_back(std::move(pending));
+        return true;
+    }
+    return Transmit(&pending, error_message);
+}
+
+bool PrinterCommandChannel::HandleResponse(const wxString &command,
+                                           const wxString &sequence_id,
+                                           const wxString &result,
+                                           const wxString &reason) {
+    unsigned long long parsed_id = 0;
+    if (!sequence_id.ToULongLong(&parsed_id)) {
+        return false;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::pair<CompletionHandler, CommandResult>> completed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = in_flight_.find(parsed_id);
+        if (it == in_flight_.end() || it->second.command != command) {
+            return false;
+        }
+
+        CommandResult outcome;
+        outcome.command = command;
+        outcome.sequence_id = parsed_id;
+        outcome.priority = it->second.priority;
+        outcome.result = result;
+        outcome.reason = reason;
+        outcome.latency =
+            std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.issued_at);
+        const bool accepted = result.empty() || result.IsSameAs("success", false);
+        outcome.status = accepted ? CommandStatus::Acknowledged : CommandStatus::Rejected;
+        RecordOutcome(outcome.priority, outcome.status, ToMilliseconds(outcome.latency));
+
+        completed.emplace_back(std::move(it->second.handler), outcome);
+        ReleaseSlot(outcome.priority);
+        in_flight_.erase(it);
+        FlushQueued(&completed);
+    }
+
+    for (auto &entry : completed) {
+        if (entry.first) {
+            entry.first(entry.second);
+        }
+    }
+    return true;
+}
+
+void PrinterCommandChannel::ExpireTimedOut(std::chrono::steady_clock::time_point now) {
+    std::vector<std::pair<CompletionHandler, CommandResult>> completed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+            if (now - it->second.sent_at < kCommandTimeout) {
+                ++it;
+                continue;
+            }
+            CommandResult outcome;
+            outcome.command = it->second.command;
+            outcome.sequence_id = it->second.sequence_id;
+            outcome.priority = it->second.priority;
+            outcome.status = CommandStatus::TimedOut;
+            outcome.latency =
+                std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.issued_at);
+            RecordOutcome(outcome.priority, outcome.status, ToMilliseconds(outcome.latency));
+            completed.emplace_back(std::move(it->second.handler), outcome);
+            ReleaseSlot(outcome.priority);
+            it = in_flight_.erase(it);
+        }
+        if (!completed.empty()) {
+            FlushQueued(&completed);
+        }
+    }
+
+    for (auto &entry : completed) {
+        if (entry.first) {
+            entry.first(entry.second);
+        }
+    }
+}
+
+size_t PrinterCommandChannel::GetInFlightCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_.size();
+}
+
+CommandLatencyStats PrinterCommandChannel::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+CommandLatencyStats PrinterCommandChannel::GetControlStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return control_stats_;
+}
+
+void PrinterCommandChannel::RecordOutcome(CommandPriority priority,
+                                          CommandStatus status,
+                                          double latency_ms) {
+    RecordStatus(&stats_, status, latency_ms);
+    if (priority == CommandPriority::Control) {
+        RecordStatus(&control_stats_, status, latency_ms);
+    }
+}
+
+void PrinterCommandChannel::ReleaseSlot(CommandPriority priority) {
+    size_t &in_flight =
+        priority == CommandPriority::Control ? control_in_flight_ : bulk_in_flight_;
+    if (in_flight > 0) {
+        in_flight -= 1;
+    }
+}
+
+void PrinterCommandChannel::FlushQueued(
+    std::vector<std::pair<CompletionHandler, CommandResult>> *completed) {
+    FlushQueue(&control_queued_, &control_in_flight_, kControlInFlightWindow, completed);
+    FlushQueue(&queued_, &bulk_in_flight_, kInFlightWindow, completed);
+}
+
+void PrinterCommandChannel::FlushQueue(
+    std::deque<PendingCommand> *queue,
+    const size_t *in_flight,
+    size_t window,
+    std::vector<std::pair<CompletionHandler, CommandResult>> *completed) {
+    while (!queue->empty() && *in_flight < window) {
+        PendingCommand pending = std::move(queue->front());
+        queue->pop_front();
+        wxString send_error;
+        if (!Transmit(&pending, &send_error)) {
+            CommandResult outcome;
+            outcome.command = pending.command;
+            outcome.sequence_id = pending.sequence_id;
+            outcome.priority = pending.priority;
+            outcome.status = CommandStatus::SendFailed;
+            outcome.reason = send_error;
+            completed->emplace_back(std::move(pending.handler), outcome);
+        }
+    }
+}
+
+bool PrinterCommandChannel::Transmit(PendingCommand *command, wxString *error_message) {
+    if (!publisher_) {
+        if (error_message) {
+            *error_message = "Command channel has no MQTT publisher.";
+        }
+        return false;
+    }
+    if (!publisher_(command->payload, error_message)) {
+        wxLogWarning("PrinterCommandChannel: failed to send %s (sequence %llu)",
+                     command->command,
+                     static_cast<unsigned long long>(command->sequence_id));
+        return false;
+    }
+
+    command->sent_at = std::chrono::steady_clock::now();
+    stats_.sent += 1;
+    if (command->priority == CommandPriority::Control) {
+        control_stats_.sent += 1;
+        control_in_flight_ += 1;
+    } else {
+        bulk_in_flight_ += 1;
+    }
+    const uint64_t sequence_id = command->sequence_id;
+    in_flight_.emplace(sequence_id, std::move(*command));
+    return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <wx/string.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class CommandStatus {
+    Acknowledged,
+    Rejected,
+    TimedOut,
+    SendFailed,
+    // Published successfully; the command has no acknowledgement (e.g. pushall).
+    Sent,
+    // Never sent: the coordinator stopped while the command was still queued.
+    Cancelled,
+};
+
+// Control commands (pause, resume, stop, lights) have their own in-flight window
+// and queue, and queued control commands are always sent before queued bulk ones.
+enum class CommandPriority {
+    Bulk,
+    Control,
+};
+
+struct CommandResult {
+    wxString command;
+    uint64_t sequence_id = 0;
+    CommandPriority priority = CommandPriority::Bulk;
+    CommandStatus status = CommandStatus::SendFailed;
+    wxString result;
+    wxString reason;
+    // Measured from the call to Send, so time spent queued is included.
+    std::chrono::microseconds latency{0};
+};
+
+struct CommandLatencyStats {
+    uint64_t sent = 0;
+    uint64_t acknowledged = 0;
+    uint64_t rejected = 0;
+    uint64_t timed_out = 0;
+    double last_ms = 0.0;
+    double average_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+class PrinterCommandChannel {
+public:
+    // Payloads are UTF-8 JSON, published as-is.
+    using Publisher = std::function<bool(const std::string &payload, wxString *error_message)>;
+    using CompletionHandler = std::function<void(const CommandResult &result)>;
+
+    void SetPublisher(Publisher publisher);
+    static uint64_t NextSequenceId();
+
+    bool Send(const wxString &command,
+              uint64_t sequence_id,
+              std::string payload,
+              CompletionHandler handler,
+              wxString *error_message);
+    bool SendControl(const wxString &command,
+                     uint64_t sequence_id,
+                     std::string payload,
+                     CompletionHandler handler,
+                     wxString *error_message);
+    bool HandleResponse(const wxString &command,
+                        const wxString &sequence_id,
+                        const wxString &result,
+                        const wxString &reason);
+    void ExpireTimedOut(std::chrono::steady_clock::time_point now);
+    size_t GetInFlightCount() const;
+    CommandLatencyStats GetStats() const;
+    CommandLatencyStats GetControlStats() const;
+
+private:
+    struct PendingCommand {
+        wxString command;
+        uint64_t sequence_id = 0;
+        CommandPriority priority = CommandPriority::Bulk;
+        std::string payload;
+        CompletionHandler handler;
+        std::chrono::steady_clock::time_point issued_at;
+        std::chrono::steady_clock::time_point sent_at;
+    };
+
+    bool Submit(PendingCommand pending, wxString *error_message);
+    void RecordOutcome(CommandPriority priority, CommandStatus status, double latency_ms);
+    void ReleaseSlot(CommandPriority priority);
+    void FlushQueued(std::vector<std::pair<CompletionHandler, CommandResult>> *completed);
+    void FlushQueue(std::deque<PendingCommand> *queue,
+                    const size_t *in_flight,
+                    size_t window,
+                    std::vector<std::pair<CompletionHandler, CommandResult>> *completed);
+    bool Transmit(PendingCommand *command, wxString *error_message);
+
+    mutable std::mutex mutex_;
+    Publisher publisher_;
+    std::map<uint64_t, PendingCommand> in_flight_;
+    std::deque<PendingCommand> queued_;
+    std::deque<PendingCommand> control_queued_;
+    size_t bulk_in_flight_ = 0;
+    size_t control_in_flight_ = 0;
+    CommandLatencyStats stats_;
+    CommandLatencyStats control_stats_;
+};
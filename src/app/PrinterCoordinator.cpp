@@ -1,147 +1,199 @@
 #include "app/PrinterCoordinator.h"
 
+#include "app/StringUtil.h"
+
 #include <wx/filename.h>
 #include <wx/log.h>
 
-#include <cctype>
-#include <optional>
+#include <algorithm>
+#include <set>
 
 namespace {
-wxString EscapeJsonString(const wxString &value) {
-    wxString escaped;
-    escaped.reserve(value.size());
-    for (const wxUniChar ch : value) {
-        if (ch == '\\') {
-            escaped += "\\\\";
-        } else if (ch == '"') {
-            escaped += "\\\"";
-        } else if (ch == '\n') {
-            escaped += "\\n";
-        } else if (ch == '\r') {
-            escaped += "\\r";
-        } else if (ch == '\t') {
-            escaped += "\\t";
-        } else {
-            escaped += ch;
-        }
-    }
-    return escaped;
-}
-
-std::optional<wxString> ExtractJsonString(const wxString &payload, const wxString &key) {
-    const std::string data = payload.ToStdString();
-    const std::string needle = "\"" + key.ToStdString() + "\"";
-    size_t pos = data.find(needle);
-    if (pos == std::string::npos) {
-        return std::nullopt;
-    }
-    pos = data.find(':', pos);
-    if (pos == std::string::npos) {
-        return std::nullopt;
-    }
-    ++pos;
-    while (pos < data.size() && std::isspace(static_cast<unsigned char>(data[pos]))) {
-        ++pos;
-    }
-    if (pos >= data.size() || data[pos] != '"') {
-        return std::nullopt;
-    }
-    ++pos;
-    std::string value;
-    while (pos < data.size()) {
-        char ch = data[pos];
-        if (ch == '"') {
-            break;
-        }
-        if (ch == '\\' && pos + 1 < data.size()) {
-            char next = data[pos + 1];
-            if (next == '"' || next == '\\') {
-                value += next;
-                pos += 2;
-                continue;
-            }
-        }
-        value += ch;
-        ++pos;
-    }
-    return wxString::FromUTF8(value);
-}
+constexpr auto kCommandTickInterval = std::chrono::milliseconds(1000);
+constexpr size_t kMaxEventBatch = 256;
+constexpr size_t kStartupBatchSize = 8;
+constexpr auto kStartupBatchInterval = std::chrono::milliseconds(750);
+constexpr char kBrokerReportTopic[] = "device/+/report";
+constexpr size_t kCommandThreads = 8;
+constexpr char kUploadingStatus[] = "uploading";
+constexpr char kStagedStatus[] = "staged";
+// A printer only ever needs its current print and its staged next job, and those
+// are always the two files it used most recently.
+constexpr size_t kPinnedRemoteFiles = 2;
+// Printers report IDLE for a moment while setting up a print and between prints,
+// so IDLE alone only completes a job once it has lasted this long.
+constexpr auto kIdleHoldTime = std::chrono::seconds(20);
+// How long a printer that never acknowledged a print command gets to report the
+// job in PREPARE or RUNNING before the job goes back to the queue.
+constexpr auto kStartDeadline = std::chrono::seconds(90);
+// A printer whose dispatch failed waits this long before asking for work again, so
+// the job it gave back can go to another printer and a fault is not retried in a
+// tight loop.
+constexpr auto kDispatchRetryDelay = std::chrono::seconds(60);
+// Inside the upload-ahead window the queue is reread at most this often unless
+// something the coordinator did changed it; imports are picked up on the next one.
+constexpr auto kStageRecheckInterval = std::chrono::seconds(30);
+// AMS changes are tracked too: they decide which printers can take which jobs.
+// Remaining time moves the forecast that upload-ahead waits on.
+constexpr PrinterFieldMask kJobTrackingFields =
+    PrinterField::GcodeState | PrinterField::GcodeFile | PrinterField::Progress |
+    PrinterField::RemainingTime | PrinterField::Ams;
 
-std::optional<int> ExtractJsonInt(const wxString &payload, const wxString &key) {
-    const std::string data = payload.ToStdString();
-    const std::string needle = "\"" + key.ToStdString() + "\"";
-    size_t pos = data.find(needle);
-    if (pos == std::string::npos) {
-        return std::nullopt;
-    }
-    pos = data.find(':', pos);
-    if (pos == std::string::npos) {
-        return std::nullopt;
-    }
-    ++pos;
-    while (pos < data.size() && std::isspace(static_cast<unsigned char>(data[pos]))) {
-        ++pos;
-    }
-    std::string number;
-    while (pos < data.size() &&
-           (std::isdigit(static_cast<unsigned char>(data[pos])) || data[pos] == '-' ||
-            data[pos] == '.')) {
-        number += data[pos];
-        ++pos;
+std::string SerialFromReportTopic(std::string_view topic) {
+    constexpr std::string_view kPrefix = "device/";
+    constexpr std::string_view kSuffix = "/report";
+    if (topic.size() <= kPrefix.size() + kSuffix.size() ||
+        topic.substr(0, kPrefix.size()) != kPrefix ||
+        topic.substr(topic.size() - kSuffix.size()) != kSuffix) {
+        return std::string();
     }
-    try {
-        if (!number.empty()) {
-            return static_cast<int>(std::stod(number));
-        }
-    } catch (const std::exception &) {
-    }
-    return std::nullopt;
+    topic.remove_prefix(kPrefix.size());
+    topic.remove_suffix(kSuffix.size());
+    return std::string(topic);
 }
 
 wxString PrinterKey(const PrinterDefinition &printer) {
     return printer.name.empty() ? printer.host : printer.name;
 }
 
-wxString BuildProjectFilePayload(const wxString &remote_file, int plate_index) {
-    const wxString plate_path =
-        wxString::Format("Metadata/plate_%d.gcode", plate_index <= 0 ? 1 : plate_index);
-    return wxString::Format(
-        "{"
-        "\"print\":{"
-        "\"command\":\"project_file\","
-        "\"param\":\"%s\","
-        "\"file\":\"%s\","
-        "\"url\":\"ftp:///%s\","
-        "\"bed_leveling\":true,"
-        "\"flow_cali\":true,"
-        "\"vibration_cali\":true,"
-        "\"layer_inspect\":false,"
-        "\"sequence_id\":\"10000000\""
-        "}"
-        "}",
-        EscapeJsonString(plate_path),
-        EscapeJsonString(remote_file),
-        EscapeJsonString(remote_file));
-}
-
-bool IsPrintingState(const wxString &state) {
-    const wxString lowered = state.Lower();
-    return lowered.Contains("print") || lowered.Contains("run") || lowered.Contains("busy");
-}
-
-bool IsCompletedState(const wxString &state) {
-    const wxString lowered = state.Lower();
-    return lowered.Contains("finish") || lowered.Contains("complete") || lowered.Contains("idle");
+constexpr CommandTemplate kProjectFileTemplate(
+    "{"
+    "\"print\":{"
+    "\"command\":\"project_file\","
+    "\"param\":\"Metadata/plate_%s.gcode\","
+    "\"file\":\"%s\","
+    "\"url\":\"ftp:///%s\","
+    "\"bed_leveling\":true,"
+    "\"flow_cali\":true,"
+    "\"vibration_cali\":true,"
+    "\"layer_inspect\":false,"
+    "\"sequence_id\":\"%s\""
+    "}"
+    "}");
+// The mapping splice is a bare JSON array of tray numbers, which escaping leaves alone.
+constexpr CommandTemplate kProjectFileAmsTemplate(
+    "{"
+    "\"print\":{"
+    "\"command\":\"project_file\","
+    "\"param\":\"Metadata/plate_%s.gcode\","
+    "\"file\":\"%s\","
+    "\"url\":\"ftp:///%s\","
+    "\"bed_leveling\":true,"
+    "\"flow_cali\":true,"
+    "\"vibration_cali\":true,"
+    "\"layer_inspect\":false,"
+    "\"use_ams\":true,"
+    "\"ams_mapping\":%s,"
+    "\"sequence_id\":\"%s\""
+    "}"
+    "}");
+constexpr CommandTemplate kPushAllTemplate(
+    "{\"pushing\":{\"command\":\"pushall\",\"sequence_id\":\"%s\"}}");
+constexpr CommandTemplate kPrintControlTemplate(
+    "{\"print\":{\"command\":\"%s\",\"sequence_id\":\"%s\"}}");
+constexpr CommandTemplate kChamberLightTemplate(
+    "{"
+    "\"system\":{"
+    "\"command\":\"ledctrl\","
+    "\"led_node\":\"chamber_light\","
+    "\"led_mode\":\"%s\","
+    "\"led_on_time\":500,"
+    "\"led_off_time\":500,"
+    "\"loop_times\":0,"
+    "\"interval_time\":0,"
+    "\"sequence_id\":\"%s\""
+    "}"
+    "}");
+static_assert(kProjectFileTemplate.GetSpliceCount() == 4);
+static_assert(kProjectFileAmsTemplate.GetSpliceCount() == 5);
+static_assert(kPushAllTemplate.GetSpliceCount() == 1);
+static_assert(kPrintControlTemplate.GetSpliceCount() == 2);
+static_assert(kChamberLightTemplate.GetSpliceCount() == 2);
+
+// |ams_mapping| is empty when the job records no filament to map.
+std::string BuildProjectFilePayload(const wxString &remote_file,
+                                    int plate_index,
+                                    std::string_view ams_mapping,
+                                    uint64_t sequence_id) {
+    std::array<char, 20> plate_buffer;
+    std::array<char, 20> sequence_buffer;
+    const std::string file = ToUtf8(remote_file);
+    const std::string_view plate =
+        FormatUnsigned(static_cast<uint64_t>(plate_index <= 0 ? 1 : plate_index), &plate_buffer);
+    const std::string_view sequence = FormatUnsigned(sequence_id, &sequence_buffer);
+    if (ams_mapping.empty()) {
+        return kProjectFileTemplate.Render({plate, file, file, sequence});
+    }
+    return kProjectFileAmsTemplate.Render({plate, file, file, ams_mapping, sequence});
+}
+
+std::string BuildPushAllPayload() {
+    std::array<char, 20> sequence_buffer;
+    return kPushAllTemplate.Render(
+        {FormatUnsigned(PrinterCommandChannel::NextSequenceId(), &sequence_buffer)});
+}
+
+std::string BuildPrintControlPayload(std::string_view command, uint64_t sequence_id) {
+    std::array<char, 20> sequence_buffer;
+    return kPrintControlTemplate.Render({command, FormatUnsigned(sequence_id, &sequence_buffer)});
+}
+
+std::string BuildChamberLightPayload(bool on, uint64_t sequence_id) {
+    std::array<char, 20> sequence_buffer;
+    return kChamberLightTemplate.Render(
+        {on ? "on" : "off", FormatUnsigned(sequence_id, &sequence_buffer)});
+}
+
+wxString FarmCommandName(FarmCommand command) {
+    switch (command) {
+    case FarmCommand::PushAll:
+        return "pushall";
+    case FarmCommand::Pause:
+        return "pause";
+    case FarmCommand::Resume:
+        return "resume";
+    case FarmCommand::Stop:
+        return "stop";
+    case FarmCommand::LightOn:
+    case FarmCommand::LightOff:
+        return "ledctrl";
+    }
+    return wxEmptyString;
+}
+
+std::string BuildControlPayload(FarmCommand command, uint64_t sequence_id) {
+    if (command == FarmCommand::LightOn || command == FarmCommand::LightOff) {
+        return BuildChamberLightPayload(command == FarmCommand::LightOn, sequence_id);
+    }
+    return BuildPrintControlPayload(ToUtf8(FarmCommandName(command)), sequence_id);
 }
 }  // namespace
 
 PrinterCoordinator::PrinterCoordinator(const AppConfig &config, DatabaseManager &database)
-    : config_(config), database_(database) {}
+    : config_(config),
+      database_(database),
+      reactor_(static_cast<size_t>(config.mqtt_io_threads)),
+      timeline_(state_store_) {}
 
 PrinterCoordinator::~PrinterCoordinator() {
+    replay_cancelled_ = true;
+    if (replay_thread_.joinable()) {
+        replay_thread_.join();
+    }
+    upload_workers_.Stop();
+    command_workers_.Stop();
+    event_loop_stopping_ = true;
+    events_.Wake();
+    if (event_loop_thread_.joinable()) {
+        event_loop_thread_.join();
+    }
+    broker_mqtt_.Stop();
     for (auto &entry : sessions_) {
         entry.second.mqtt.Stop();
     }
+    reactor_.Stop();
+    timeline_.Stop();
+    report_recorder_.Close();
 }
 
 bool PrinterCoordinator::Start(wxString *error_message) {
@@ -153,7 +205,25 @@ bool PrinterCoordinator::Start(wxString *error_message) {
     if (!database_.EnsurePrinters(config_.printers, &printer_ids, error_message)) {
         return false;
     }
+    if (!IsReplaying() && (!database_.RequeueJobs(kUploadingStatus, error_message) ||
+                           !database_.RequeueJobs(kStagedStatus, error_message))) {
+        return false;
+    }
+    if (!reactor_.Start(error_message)) {
+        return false;
+    }
+
+    timeline_.Start();
+    upload_workers_.Start(static_cast<size_t>(config_.upload_threads));
+    command_workers_.Start(kCommandThreads);
+    if (!config_.report_record_path.empty() && !IsReplaying()) {
+        if (!report_recorder_.Open(config_.report_record_path, error_message)) {
+            return false;
+        }
+        wxLogMessage("PrinterCoordinator: recording reports to %s", config_.report_record_path);
+    }
 
+    size_t session_index = 0;
     for (const auto &printer : config_.printers) {
         if (printer.host.empty() || printer.access_code.empty() || printer.serial.empty()) {
             wxLogWarning("PrinterCoordinator: skipping printer with missing host/access/serial.");
@@ -161,13 +231,34 @@ bool PrinterCoordinator::Start(wxString *error_message) {
         }
 
         const wxString key = PrinterKey(printer);
-        auto [it_session, inserted] = sessions_.emplace(key, PrinterSession{});
+        auto [it_session, inserted] = sessions_.try_emplace(key);
         PrinterSession &session = it_session->second;
         session.definition = printer;
+        session.key = key;
+        session.mqtt.SetReactor(&reactor_);
+        session.mqtt.SetStartDelay(kStartupBatchInterval *
+                                   static_cast<int>(session_index / kStartupBatchSize));
+        session.mqtt.SetConnectionHandler([this, &session](bool connected) {
+            if (connected) {
+                HandleConnected(session);
+            }
+        });
+        session.commands.SetPublisher(
+            [this, &session](const std::string &payload, wxString *error) {
+                return PublishRequest(session, payload, error);
+            });
+        session_index += 1;
         auto it = printer_ids.find(key);
         if (it != printer_ids.end()) {
             session.printer_id = it->second;
         }
+        if (IsReplaying()) {
+            continue;
+        }
+        if (UsesBroker()) {
+            sessions_by_serial_[printer.serial.ToStdString()] = &session;
+            continue;
+        }
 
         const wxString report_topic =
             wxString::Format("device/%s/report", printer.serial);
@@ -176,103 +267,1080 @@ bool PrinterCoordinator::Start(wxString *error_message) {
                 printer.host,
                 printer.access_code,
                 report_topic,
-                [this, key](const wxString &topic, const wxString &payload) {
-                    wxUnusedVar(topic);
-                    auto it_session = sessions_.find(key);
-                    if (it_session == sessions_.end()) {
-                        return;
-                    }
-                    HandleReport(it_session->second, payload);
-                },
+                MqttClient::RawMessageHandler(
+                    [this, &session](std::string_view topic, std::string_view payload) {
+                        wxUnusedVar(topic);
+                        HandleReport(session, payload);
+                    }),
                 &subscribe_error)) {
             wxLogWarning("PrinterCoordinator: failed to subscribe to %s: %s",
                          report_topic,
                          subscribe_error);
         }
+    }
 
-        DispatchNextJob(session);
+    if (IsReplaying()) {
+        replay_thread_ = std::thread([this]() { ReplayRecording(); });
+    } else if (UsesBroker() && !StartBrokerSession(error_message)) {
+        return false;
     }
 
+    event_loop_thread_ = std::thread([this]() { RunEventLoop(); });
     return true;
 }
 
-void PrinterCoordinator::HandleReport(PrinterSession &printer, const wxString &payload) {
-    const auto gcode_state = ExtractJsonString(payload, "gcode_state");
-    const auto gcode_file = ExtractJsonString(payload, "gcode_file");
-    const auto percent = ExtractJsonInt(payload, "mc_percent");
+bool PrinterCoordinator::UsesBroker() const {
+    return !config_.mqtt_broker_host.empty();
+}
+
+bool PrinterCoordinator::IsReplaying() const {
+    return !config_.report_replay_path.empty();
+}
+
+bool PrinterCoordinator::StartBrokerSession(wxString *error_message) {
+    broker_mqtt_.SetReactor(&reactor_);
+    broker_mqtt_.SetEndpoint(static_cast<int>(config_.mqtt_broker_port),
+                             config_.mqtt_broker_tls,
+                             config_.mqtt_broker_username);
+    broker_mqtt_.SetConnectionHandler([this](bool connected) {
+        if (!connected) {
+            return;
+        }
+        for (auto &entry : sessions_) {
+            HandleConnected(entry.second);
+        }
+    });
+    const bool subscribed = broker_mqtt_.Subscribe(
+        config_.mqtt_broker_host,
+        config_.mqtt_broker_password,
+        kBrokerReportTopic,
+        MqttClient::RawMessageHandler([this](std::string_view topic, std::string_view payload) {
+            auto it_session = sessions_by_serial_.find(SerialFromReportTopic(topic));
+            if (it_session == sessions_by_serial_.end()) {
+                return;
+            }
+            HandleReport(*it_session->second, payload);
+        }),
+        error_message);
+    if (subscribed) {
+        wxLogMessage("PrinterCoordinator: routing %zu printers through broker %s:%ld",
+                     sessions_by_serial_.size(),
+                     config_.mqtt_broker_host,
+                     config_.mqtt_broker_port);
+    }
+    return subscribed;
+}
 
-    if (!gcode_state || !gcode_file) {
+// Replays a recording through HandleReport in place of live MQTT sessions.
+// Commands and uploads are suppressed so a replay never reaches real printers.
+void PrinterCoordinator::ReplayRecording() {
+    wxLogMessage("PrinterCoordinator: replaying %s at %s",
+                 config_.report_replay_path,
+                 config_.report_replay_speed > 0.0
+                     ? wxString::Format("%gx", config_.report_replay_speed)
+                     : wxString("full speed"));
+    uint64_t unknown_printers = 0;
+    ReportReplayStats stats;
+    wxString replay_error;
+    const bool replayed = ReplayReportRecording(
+        config_.report_replay_path,
+        config_.report_replay_speed,
+        replay_cancelled_,
+        [this, &unknown_printers](const RecordedReport &report) {
+            auto it_session = sessions_.find(wxString::FromUTF8(report.printer_key));
+            if (it_session == sessions_.end()) {
+                unknown_printers += 1;
+                return;
+            }
+            HandleReport(it_session->second, report.payload);
+        },
+        &stats,
+        &replay_error);
+    if (!replayed) {
+        wxLogError("PrinterCoordinator: replay failed: %s", replay_error);
         return;
     }
 
-    const wxFileName file_name(*gcode_file);
-    int job_id = 0;
-    if (!database_.FindActiveJobByFileName(file_name.GetFullName(),
-                                           printer.printer_id,
-                                           &job_id,
-                                           nullptr) ||
-        job_id == 0) {
+    const double seconds = std::max(stats.elapsed_seconds, 1e-9);
+    wxLogMessage("PrinterCoordinator: replayed %llu reports (%.1f MB, %.1f s recorded) in "
+                 "%.3f s, %.0f reports/s, %llu for unknown printers, %llu coalesced",
+                 static_cast<unsigned long long>(stats.reports),
+                 static_cast<double>(stats.bytes) / (1024.0 * 1024.0),
+                 stats.recorded_seconds,
+                 stats.elapsed_seconds,
+                 static_cast<double>(stats.reports) / seconds,
+                 static_cast<unsigned long long>(unknown_printers),
+                 static_cast<unsigned long long>(coalesced_state_changes_.load()));
+}
+
+std::map<wxString, CommandLatencyStats> PrinterCoordinator::GetCommandStats() const {
+    std::map<wxString, CommandLatencyStats> stats;
+    for (const auto &entry : sessions_) {
+        stats[entry.first] = entry.second.commands.GetStats();
+    }
+    return stats;
+}
+
+PrinterStateStore &PrinterCoordinator::GetStateStore() {
+    return state_store_;
+}
+
+const PrinterTimeline &PrinterCoordinator::GetTimeline() const {
+    return timeline_;
+}
+
+bool PrinterCoordinator::PausePrint(const wxString &printer_key,
+                                    CommandCompletion handler,
+                                    wxString *error_message) {
+    return SendControlCommand(printer_key, FarmCommand::Pause, std::move(handler), error_message);
+}
+
+bool PrinterCoordinator::ResumePrint(const wxString &printer_key,
+                                     CommandCompletion handler,
+                                     wxString *error_message) {
+    return SendControlCommand(printer_key, FarmCommand::Resume, std::move(handler), error_message);
+}
+
+bool PrinterCoordinator::StopPrint(const wxString &printer_key,
+                                   CommandCompletion handler,
+                                   wxString *error_message) {
+    return SendControlCommand(printer_key, FarmCommand::Stop, std::move(handler), error_message);
+}
+
+bool PrinterCoordinator::SetChamberLight(const wxString &printer_key,
+                                         bool on,
+                                         CommandCompletion handler,
+                                         wxString *error_message) {
+    return SendControlCommand(printer_key,
+                              on ? FarmCommand::LightOn : FarmCommand::LightOff,
+                              std::move(handler),
+                              error_message);
+}
+
+bool PrinterCoordinator::Broadcast(FarmCommand command,
+                                   const std::vector<wxString> &printer_keys,
+                                   CommandBroadcast::Completion handler,
+                                   wxString *error_message) {
+    std::vector<wxString> keys = printer_keys;
+    if (keys.empty()) {
+        for (const auto &entry : sessions_) {
+            keys.push_back(entry.first);
+        }
+    }
+    if (keys.empty()) {
+        if (error_message) {
+            *error_message = "Broadcast failed: no printers are configured.";
+        }
+        return false;
+    }
+
+    const wxString command_name = FarmCommandName(command);
+    auto broadcast = std::make_shared<CommandBroadcast>(
+        command_name,
+        keys,
+        [command_name, handler = std::move(handler)](const BroadcastResult &result) {
+            wxLogMessage("PrinterCoordinator: %s acknowledged by %zu, published unacknowledged "
+                         "to %zu, failed on %zu of %zu printers in %.1f ms",
+                         command_name,
+                         result.succeeded,
+                         result.published,
+                         result.failed,
+                         result.printers.size(),
+                         static_cast<double>(result.elapsed.count()) / 1000.0);
+            if (handler) {
+                handler(result);
+            }
+        });
+
+    // A publish can block on a congested socket, so each send goes to the command
+    // workers; acknowledgements then arrive concurrently on the reactor threads.
+    for (size_t index = 0; index < keys.size(); ++index) {
+        auto send = [this, command, index, key = keys[index], broadcast]() {
+            auto it_session = sessions_.find(key);
+            if (it_session == sessions_.end()) {
+                broadcast->Fail(index, "Unknown printer.");
+                return;
+            }
+            PrinterSession &printer = it_session->second;
+            wxString send_error;
+            if (command == FarmCommand::PushAll) {
+                const auto issued_at = std::chrono::steady_clock::now();
+                if (!PublishRequest(printer, BuildPushAllPayload(), &send_error)) {
+                    broadcast->Fail(index, send_error);
+                    return;
+                }
+                CommandResult result;
+                result.command = "pushall";
+                result.status = CommandStatus::Sent;
+                result.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - issued_at);
+                broadcast->Complete(index, result);
+                return;
+            }
+            if (!SendControlCommand(printer,
+                                    command,
+                                    [broadcast, index](const CommandResult &result) {
+                                        broadcast->Complete(index, result);
+                                    },
+                                    &send_error)) {
+                broadcast->Fail(index, send_error);
+            }
+        };
+        const bool posted = command_workers_.Post(
+            std::move(send), [broadcast, index]() { broadcast->Cancel(index); });
+        if (!posted) {
+            broadcast->Fail(index, "The printer coordinator is not running.");
+        }
+    }
+    return true;
+}
+
+bool PrinterCoordinator::SendControlCommand(const wxString &printer_key,
+                                            FarmCommand command,
+                                            CommandCompletion handler,
+                                            wxString *error_message) {
+    auto it_session = sessions_.find(printer_key);
+    if (it_session == sessions_.end()) {
+        if (error_message) {
+            *error_message = wxString::Format("Unknown printer %s.", printer_key);
+        }
+        return false;
+    }
+    const wxString printer_name = printer_key;
+    return SendControlCommand(
+        it_session->second,
+        command,
+        [printer_name, handler = std::move(handler)](const CommandResult &result) {
+            const double latency_ms = static_cast<double>(result.latency.count()) / 1000.0;
+            if (result.status == CommandStatus::Acknowledged) {
+                wxLogMessage("PrinterCoordinator: %s acknowledged %s in %.1f ms",
+                             printer_name,
+                             result.command,
+                             latency_ms);
+            } else {
+                wxLogWarning("PrinterCoordinator: %s %s failed after %.1f ms: %s %s",
+                             printer_name,
+                             result.command,
+                             latency_ms,
+                             result.result,
+                             result.reason);
+            }
+            if (handler) {
+                handler(result);
+            }
+        },
+        error_message);
+}
+
+bool PrinterCoordinator::SendControlCommand(PrinterSession &printer,
+                                            FarmCommand command,
+                                            CommandCompletion handler,
+                                            wxString *error_message) {
+    const uint64_t sequence_id = PrinterCommandChannel::NextSequenceId();
+    return printer.commands.SendControl(FarmCommandName(command),
+                                        sequence_id,
+                                        BuildControlPayload(command, sequence_id),
+                                        std::move(handler),
+                                        error_message);
+}
+
+void PrinterCoordinator::PostEvent(CoordinatorEvent event) {
+    events_.Push(std::move(event));
+}
+
+// The coordinator thread. Everything queued since it last woke is handled as one
+// batch, and unacknowledged commands are expired once per tick.
+void PrinterCoordinator::RunEventLoop() {
+    std::vector<CoordinatorEvent> batch;
+    batch.reserve(kMaxEventBatch);
+    auto next_tick = std::chrono::steady_clock::now() + kCommandTickInterval;
+    while (!event_loop_stopping_) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next_tick) {
+            ExpireCommands(now);
+            SettleIdleReports(now);
+            CheckStartDeadlines(now);
+            RetryDispatches(now);
+            next_tick = now + kCommandTickInterval;
+        }
+        CoordinatorEvent event;
+        if (!events_.WaitPop(&event,
+                             std::chrono::ceil<std::chrono::milliseconds>(next_tick - now))) {
+            continue;
+        }
+        batch.push_back(std::move(event));
+        while (batch.size() < kMaxEventBatch && events_.TryPop(&event)) {
+            batch.push_back(std::move(event));
+        }
+        HandleEvents(&batch);
+        batch.clear();
+    }
+}
+
+void PrinterCoordinator::HandleEvents(std::vector<CoordinatorEvent> *events) {
+    // Every report behind a StateChanged in this batch was merged before the batch
+    // was taken, so one look at the store per printer covers all of them.
+    std::set<const PrinterSession *> refreshed;
+    const auto now = std::chrono::steady_clock::now();
+    for (CoordinatorEvent &event : *events) {
+        switch (event.type) {
+        case EventType::Connected:
+            RequestDispatch(*event.printer);
+            break;
+        case EventType::StateChanged: {
+            if (!refreshed.insert(event.printer).second) {
+                coalesced_state_changes_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            PrinterSession &session = *event.printer;
+            PrinterState state;
+            if (!state_store_.GetState(session.key, &state)) {
+                break;
+            }
+            const bool trays_changed =
+                compatibility_.SetPrinterTrays(session.printer_id, state.ams_trays);
+            HandleStateChange(session, state, now);
+            if (trays_changed) {
+                // Newly loaded filament may suit a job that was waiting for it.
+                RequestDispatch(session);
+            }
+            if (config_.upload_ahead_minutes > 0) {
+                StageWithinWindow(session, now);
+            }
+            break;
+        }
+        case EventType::UploadFinished:
+            if (event.staged) {
+                HandleStagedUploadFinished(
+                    *event.printer, event.job, event.uploaded, event.upload_error);
+            } else {
+                HandleUploadFinished(*event.printer, event.job, event.uploaded, event.upload_error);
+            }
+            break;
+        case EventType::CommandFinished:
+            HandleDispatchResult(*event.printer, event.job_id, event.result);
+            break;
+        }
+    }
+}
+
+void PrinterCoordinator::ExpireCommands(std::chrono::steady_clock::time_point now) {
+    for (auto &entry : sessions_) {
+        entry.second.commands.ExpireTimedOut(now);
+    }
+}
+
+void PrinterCoordinator::HandleConnected(PrinterSession &printer) {
+    wxString publish_error;
+    if (!PublishRequest(printer, BuildPushAllPayload(), &publish_error)) {
+        wxLogWarning("PrinterCoordinator: pushall to %s failed: %s",
+                     printer.definition.name,
+                     publish_error);
+    }
+    CoordinatorEvent event;
+    event.type = EventType::Connected;
+    event.printer = &printer;
+    PostEvent(std::move(event));
+}
+
+bool PrinterCoordinator::PublishRequest(PrinterSession &printer,
+                                        std::string_view payload,
+                                        wxString *error_message) {
+    if (IsReplaying()) {
+        if (error_message) {
+            *error_message = "Commands are disabled while replaying a recording.";
+        }
+        return false;
+    }
+    const wxString command_topic =
+        wxString::Format("device/%s/request", printer.definition.serial);
+    if (UsesBroker()) {
+        return broker_mqtt_.Publish(config_.mqtt_broker_host,
+                                    config_.mqtt_broker_password,
+                                    command_topic,
+                                    payload,
+                                    error_message);
+    }
+    return printer.mqtt.Publish(printer.definition.host,
+                                printer.definition.access_code,
+                                command_topic,
+                                payload,
+                                error_message);
+}
+
+void PrinterCoordinator::HandleReport(PrinterSession &printer, std::string_view payload) {
+    if (!config_.report_record_path.empty()) {
+        report_recorder_.Record(std::string(printer.key.utf8_str()), payload);
+    }
+
+    PrinterReport report;
+    if (!ParsePrinterReport(payload, &report)) {
+        wxLogWarning("PrinterCoordinator: ignoring malformed report from %s",
+                     printer.definition.name);
         return;
     }
 
-    if (IsPrintingState(*gcode_state)) {
-        if (database_.UpdateJobStatus(job_id, "printing", config_.jobs_dir, config_.completed_dir,
-                                      nullptr)) {
-            printer.is_printing = true;
+    if (report.command && report.sequence_id && *report.command != "push_status") {
+        printer.commands.HandleResponse(wxString::FromUTF8(*report.command),
+                                        wxString::FromUTF8(*report.sequence_id),
+                                        wxString::FromUTF8(report.result.value_or("")),
+                                        wxString::FromUTF8(report.reason.value_or("")));
+    }
+
+    // Posted straight from the reader thread; HandleEvents reads the merged state
+    // once per printer per batch, however many reports arrived behind it.
+    if ((state_store_.Apply(printer.key, report) & kJobTrackingFields) != 0) {
+        CoordinatorEvent event;
+        event.type = EventType::StateChanged;
+        event.printer = &printer;
+        PostEvent(std::move(event));
+    }
+}
+
+// Runs for every batched change while a printer prints, so it works off the
+// session's tracker and only touches the database when the job's state moves.
+void PrinterCoordinator::HandleStateChange(PrinterSession &printer,
+                                           const PrinterState &state,
+                                           std::chrono::steady_clock::time_point now) {
+    if (state.gcode_state.empty() || state.gcode_file.empty()) {
+        return;
+    }
+
+    JobTracker &tracker = printer.tracker;
+    const GcodeState gcode_state = LookupGcodeState(state.gcode_state);
+    const bool state_changed = gcode_state != tracker.gcode_state;
+    tracker.gcode_state = gcode_state;
+    if (state.gcode_file != tracker.gcode_file) {
+        const wxString file_name =
+            wxFileName(wxString::FromUTF8(state.gcode_file)).GetFullName().Lower();
+        if (tracker.awaiting_file && file_name != tracker.file_name) {
+            return;
+        }
+        tracker.gcode_file = state.gcode_file;
+        tracker.awaiting_file = false;
+        if (file_name != tracker.file_name) {
+            tracker.file_name = file_name;
+            LookupTrackedJob(printer);
         }
+    } else if (tracker.job_id == 0 && state_changed) {
+        // A job for this file may have been queued since the last look.
+        LookupTrackedJob(printer);
+    }
+    if (tracker.job_id == 0) {
         return;
     }
+    if (gcode_state != GcodeState::Idle) {
+        tracker.idle_pending = false;
+    }
+    if (gcode_state == GcodeState::Prepare || IsPrintingState(gcode_state)) {
+        tracker.started = true;
+        printer.start_pending = false;
+    }
 
-    if (IsCompletedState(*gcode_state) && percent.value_or(100) >= 99) {
-        if (database_.UpdateJobStatus(job_id, "completed", config_.jobs_dir, config_.completed_dir,
-                                      nullptr)) {
-            printer.is_printing = false;
-            DispatchNextJob(printer);
+    if (IsPrintingState(gcode_state)) {
+        if (!tracker.printing) {
+            if (!SetJobStatus(tracker.job_id, "printing")) {
+                return;
+            }
+            tracker.printing = true;
+        }
+        if (TransitionDispatch(printer,
+                               {DispatchState::Idle, DispatchState::Commanded},
+                               DispatchState::Confirmed)) {
+            StageNextJob(printer);
         }
+        return;
+    }
+
+    if (!tracker.started) {
+        return;
+    }
+    const bool fully_printed = state.percent < 0 || state.percent >= 99;
+    switch (gcode_state) {
+    case GcodeState::Finish:
+        if (fully_printed) {
+            FinishTrackedJob(printer, "completed");
+        }
+        break;
+    case GcodeState::Failed:
+        FinishTrackedJob(printer, "failed");
+        break;
+    case GcodeState::Idle:
+        if (!fully_printed) {
+            tracker.idle_pending = false;
+        } else if (!tracker.idle_pending) {
+            tracker.idle_pending = true;
+            tracker.idle_since = now;
+        } else if (now - tracker.idle_since >= kIdleHoldTime) {
+            FinishTrackedJob(printer, "completed");
+        }
+        break;
+    default:
+        break;
     }
 }
 
-bool PrinterCoordinator::DispatchNextJob(PrinterSession &printer) {
-    if (printer.is_printing) {
-        return true;
+void PrinterCoordinator::LookupTrackedJob(PrinterSession &printer) {
+    JobTracker &tracker = printer.tracker;
+    tracker.job_id = 0;
+    tracker.printing = false;
+    tracker.idle_pending = false;
+    // Not dispatched by this run, e.g. found again after a restart, so whatever
+    // state the printer reports belongs to it.
+    tracker.started = true;
+    int job_id = 0;
+    if (database_.FindActiveJobByFileName(tracker.file_name, printer.printer_id, &job_id,
+                                          nullptr)) {
+        tracker.job_id = job_id;
+    }
+}
+
+void PrinterCoordinator::FinishTrackedJob(PrinterSession &printer, const char *status_name) {
+    JobTracker &tracker = printer.tracker;
+    if (!SetJobStatus(tracker.job_id, status_name)) {
+        return;
+    }
+    // The job has left the active set; a later state change looks the file up
+    // again in case it is queued to print once more.
+    tracker.job_id = 0;
+    tracker.printing = false;
+    tracker.started = false;
+    tracker.idle_pending = false;
+    // Commanded when the acknowledgement never came but the job ran anyway.
+    TransitionDispatch(
+        printer, {DispatchState::Commanded, DispatchState::Confirmed}, DispatchState::Idle);
+    RequestDispatch(printer);
+}
+
+// A printer left IDLE sends no further changes, so held IDLE reports are
+// rechecked on the tick.
+void PrinterCoordinator::SettleIdleReports(std::chrono::steady_clock::time_point now) {
+    for (auto &entry : sessions_) {
+        PrinterSession &session = entry.second;
+        if (!session.tracker.idle_pending || now - session.tracker.idle_since < kIdleHoldTime) {
+            continue;
+        }
+        PrinterState state;
+        if (state_store_.GetState(session.key, &state)) {
+            HandleStateChange(session, state, now);
+        }
+    }
+}
+
+// Takes back a job whose print command timed out when the printer has still not
+// been seen starting it.
+void PrinterCoordinator::CheckStartDeadlines(std::chrono::steady_clock::time_point now) {
+    for (auto &entry : sessions_) {
+        PrinterSession &session = entry.second;
+        if (!session.start_pending || now < session.start_deadline) {
+            continue;
+        }
+        session.start_pending = false;
+        const QueuedJob job = session.current_job;
+        if (session.tracker.started ||
+            !TransitionDispatch(session, {DispatchState::Commanded}, DispatchState::Idle)) {
+            continue;
+        }
+        wxLogWarning("PrinterCoordinator: %s never started job %d; requeueing it",
+                     session.definition.name,
+                     job.id);
+        RequeueJob(job);
+        session.tracker = JobTracker();
+        DeferDispatch(session);
+    }
+}
+
+void PrinterCoordinator::RetryDispatches(std::chrono::steady_clock::time_point now) {
+    for (auto &entry : sessions_) {
+        PrinterSession &session = entry.second;
+        if (!session.retry_pending || now < session.retry_at) {
+            continue;
+        }
+        session.retry_pending = false;
+        RequestDispatch(session);
+    }
+}
+
+void PrinterCoordinator::DeferDispatch(PrinterSession &printer) {
+    printer.retry_pending = true;
+    printer.retry_at = std::chrono::steady_clock::now() + kDispatchRetryDelay;
+}
+
+void PrinterCoordinator::RequestDispatch(PrinterSession &printer) {
+    if (IsReplaying() ||
+        !TransitionDispatch(printer, {DispatchState::Idle}, DispatchState::Uploading)) {
+        return;
+    }
+
+    if (printer.staging == StagingState::Ready) {
+        const QueuedJob job = printer.staged_job;
+        printer.staging = StagingState::None;
+        wxLogMessage("PrinterCoordinator: starting pre-staged job %d on %s",
+                     job.id,
+                     printer.definition.name);
+        HandleUploadFinished(printer, job, true, wxEmptyString);
+        return;
+    }
+    if (printer.staging == StagingState::Uploading) {
+        // The next job is already on its way; HandleStagedUploadFinished starts it.
+        return;
     }
 
     QueuedJob job;
-    if (!database_.GetNextQueuedJob(printer.printer_id, &job, nullptr)) {
-        return false;
+    if (!ClaimNextJob(printer, kUploadingStatus, &job) &&
+        !ReleaseStagedJob(printer, kUploadingStatus, &job)) {
+        TransitionDispatch(printer, {DispatchState::Uploading}, DispatchState::Idle);
+        return;
     }
-    if (job.id == 0) {
+    if (!PostUpload(printer, job, false)) {
+        RequeueJob(job);
+        TransitionDispatch(printer, {DispatchState::Uploading}, DispatchState::Idle);
+        return;
+    }
+    printer.current_job = job;
+}
+
+// Only the coordinator moves jobs in and out of "queued", so the queue is read
+// from the database once and after that only for jobs imported since.
+bool PrinterCoordinator::RefreshQueue() {
+    const uint64_t import_count = database_.GetImportCount();
+    if (queue_loaded_ && import_count == queue_import_count_) {
         return true;
     }
+    std::vector<QueuedJob> imported;
+    if (!database_.GetQueuedJobs(&imported, queue_last_id_, nullptr)) {
+        return false;
+    }
+    queue_loaded_ = true;
+    queue_import_count_ = import_count;
+    for (const QueuedJob &job : imported) {
+        queue_last_id_ = std::max(queue_last_id_, job.id);
+        AddQueuedJob(job);
+    }
+    return true;
+}
+
+void PrinterCoordinator::AddQueuedJob(const QueuedJob &job) {
+    const auto it = std::lower_bound(
+        queue_.begin(), queue_.end(), job.id, [](const QueuedJob &queued, int job_id) {
+            return queued.id < job_id;
+        });
+    if (it != queue_.end() && it->id == job.id) {
+        *it = job;
+    } else {
+        queue_.insert(it, job);
+    }
+}
 
-    const wxFileName local_file(job.file_path);
-    const wxString remote_name = local_file.GetFullName();
-    wxString upload_error;
-    if (!ftps_client_.UploadFile(printer.definition.host,
-                                 printer.definition.access_code,
+// Jobs are only claimed on the coordinator thread, so moving one out of "queued"
+// is enough to keep every other printer off it.
+bool PrinterCoordinator::ClaimNextJob(PrinterSession &printer,
+                                      const wxString &status_name,
+                                      QueuedJob *job) {
+    if (!RefreshQueue() || queue_.empty()) {
+        return false;
+    }
+    // Staged jobs stay in the matrix too, so ReleaseStagedJob can check them.
+    const size_t queued_count = queue_.size();
+    for (const auto &entry : sessions_) {
+        if (entry.second.staging != StagingState::None) {
+            queue_.push_back(entry.second.staged_job);
+        }
+    }
+    compatibility_.SyncJobs(queue_);
+    queue_.resize(queued_count);
+    std::vector<SchedulerJob> candidates;
+    candidates.reserve(queue_.size());
+    for (const QueuedJob &candidate : queue_) {
+        // A job no printer has the filament for would only hold a place in the plan.
+        if (compatibility_.HasCompatiblePrinter(candidate.id)) {
+            candidates.push_back(
+                {candidate.id, candidate.printer_id, candidate.estimated_seconds});
+        }
+    }
+    const int job_id = scheduler_.PickJob(candidates,
+                                          PredictAvailability(printer),
+                                          printer.printer_id,
+                                          [this](int candidate_id, int printer_id) {
+                                              return compatibility_.IsCompatible(candidate_id,
+                                                                                 printer_id);
+                                          });
+    const auto picked = std::find_if(queue_.begin(), queue_.end(), [job_id](const QueuedJob &q) {
+        return q.id == job_id;
+    });
+    if (picked == queue_.end() || !SetJobStatus(picked->id, status_name)) {
+        return false;
+    }
+    *job = *picked;
+    queue_.erase(picked);
+    return true;
+}
+
+// How long until each connected printer runs out of work: the timeline's
+// forecast while it prints, otherwise the slicer estimate of the job it holds,
+// plus the one staged behind it.
+std::vector<SchedulerPrinter> PrinterCoordinator::PredictAvailability(
+    const PrinterSession &requester) const {
+    std::vector<SchedulerPrinter> printers;
+    printers.reserve(sessions_.size());
+    for (const auto &entry : sessions_) {
+        const PrinterSession &session = entry.second;
+        if (&session != &requester && !state_store_.GetState(session.key, nullptr)) {
+            continue;
+        }
+        SchedulerPrinter printer;
+        printer.printer_id = session.printer_id;
+        auto add_job = [&printer](const QueuedJob &job) {
+            if (job.estimated_seconds >= 0) {
+                printer.busy_seconds += job.estimated_seconds;
+            } else {
+                ++printer.unestimated_jobs;
+            }
+        };
+        const int64_t until_free = timeline_.GetSecondsUntilFree(session.key);
+        if (until_free > 0) {
+            printer.busy_seconds = until_free;
+        } else if (session.current_job.id != 0) {
+            add_job(session.current_job);
+        }
+        if (session.staging != StagingState::None) {
+            add_job(session.staged_job);
+        }
+        printers.push_back(printer);
+    }
+    return printers;
+}
+
+// A job staged on a busy printer is better started on one that has run out of
+// work. Takes the oldest Ready staged job the requester has the filament for and
+// that is not pinned to another printer, and claims it for the requester
+// directly; the copy already uploaded to the busy printer is simply left there.
+bool PrinterCoordinator::ReleaseStagedJob(const PrinterSession &requester,
+                                          const wxString &status_name,
+                                          QueuedJob *job) {
+    PrinterSession *holder = nullptr;
+    for (auto &entry : sessions_) {
+        PrinterSession &candidate = entry.second;
+        const QueuedJob &staged = candidate.staged_job;
+        if (&candidate == &requester || candidate.staging != StagingState::Ready ||
+            (staged.printer_id != 0 && staged.printer_id != requester.printer_id) ||
+            !compatibility_.IsCompatible(staged.id, requester.printer_id)) {
+            continue;
+        }
+        if (!holder || staged.id < holder->staged_job.id) {
+            holder = &candidate;
+        }
+    }
+    if (!holder || !SetJobStatus(holder->staged_job.id, status_name)) {
+        return false;
+    }
+    wxLogMessage("PrinterCoordinator: releasing job %d staged on %s for %s",
+                 holder->staged_job.id,
+                 holder->definition.name,
+                 requester.definition.name);
+    *job = holder->staged_job;
+    holder->staging = StagingState::None;
+    ++queue_generation_;
+    return true;
+}
+
+bool PrinterCoordinator::PostUpload(PrinterSession &printer, const QueuedJob &job, bool staged) {
+    return upload_workers_.Post([this, &printer, job, staged]() {
+        CoordinatorEvent event;
+        event.type = EventType::UploadFinished;
+        event.printer = &printer;
+        event.job = job;
+        event.staged = staged;
+        event.uploaded = UploadJobFile(printer, job, &event.upload_error);
+        PostEvent(std::move(event));
+    });
+}
+
+// Runs on an upload worker. The transfer is skipped when the printer already holds
+// a file of the same name and size, as it does for a reprint.
+bool PrinterCoordinator::UploadJobFile(PrinterSession &printer,
+                                       const QueuedJob &job,
+                                       wxString *error_message) {
+    const PrinterDefinition &definition = printer.definition;
+    RemoteFileCache &cache = printer.file_cache;
+    if (!cache.IsLoaded()) {
+        std::vector<RemoteFile> files;
+        if (ftps_client_.ListFiles(definition.host, definition.access_code, &files, nullptr)) {
+            cache.Load(files);
+        }
+    }
+
+    const wxString remote_name = wxFileName(job.file_path).GetFullName();
+    const wxULongLong file_size = wxFileName(job.file_path).GetSize();
+    const bool size_known = file_size != wxInvalidSize;
+    const auto local_size = size_known ? static_cast<uint64_t>(file_size.GetValue()) : 0;
+    uint64_t cached_size = 0;
+    if (size_known && cache.Lookup(remote_name, &cached_size) && cached_size == local_size) {
+        // Someone may have deleted or replaced it on the printer since the listing.
+        bool exists = false;
+        uint64_t remote_size = 0;
+        if (ftps_client_.GetFileSize(definition.host,
+                                     definition.access_code,
+                                     remote_name,
+                                     &exists,
+                                     &remote_size,
+                                     nullptr)) {
+            cache.Refresh(remote_name, exists, remote_size);
+            if (exists && remote_size == local_size) {
+                wxLogMessage("PrinterCoordinator: %s is already on %s, skipping upload",
+                             remote_name,
+                             definition.name);
+                return true;
+            }
+        }
+    }
+
+    if (!ftps_client_.UploadFile(definition.host,
+                                 definition.access_code,
                                  job.file_path,
                                  remote_name,
-                                 &upload_error)) {
-        wxLogWarning("PrinterCoordinator: FTPS upload failed: %s", upload_error);
+                                 error_message)) {
+        // A failed transfer can leave a partial file behind.
+        cache.Remove(remote_name);
         return false;
     }
+    if (size_known) {
+        cache.RecordUpload(remote_name, local_size);
+    }
+    TrimRemoteFiles(printer);
+    return true;
+}
 
-    const wxString payload = BuildProjectFilePayload(remote_name, job.plate_index);
-    const wxString command_topic =
-        wxString::Format("device/%s/request", printer.definition.serial);
+void PrinterCoordinator::TrimRemoteFiles(PrinterSession &printer) {
+    if (config_.cache_budget_mb <= 0) {
+        return;
+    }
+    const uint64_t budget = static_cast<uint64_t>(config_.cache_budget_mb) * 1024 * 1024;
+    for (const wxString &name : printer.file_cache.TakeEvictions(budget, kPinnedRemoteFiles)) {
+        wxLogMessage("PrinterCoordinator: evicting %s from %s", name, printer.definition.name);
+        ftps_client_.RemoveFile(
+            printer.definition.host, printer.definition.access_code, name, nullptr);
+    }
+}
+
+void PrinterCoordinator::StageNextJob(PrinterSession &printer) {
+    const bool busy = printer.dispatch_state == DispatchState::Commanded ||
+                      printer.dispatch_state == DispatchState::Confirmed;
+    if (!config_.upload_ahead || IsReplaying() || !busy ||
+        printer.staging != StagingState::None) {
+        return;
+    }
+    if (config_.upload_ahead_minutes > 0) {
+        // Wait until the running print is close to done, so the scheduler picks
+        // the next job with the freshest view of the farm.
+        const int64_t until_free = timeline_.GetSecondsUntilFree(printer.key);
+        if (printer.dispatch_state != DispatchState::Confirmed || until_free < 0 ||
+            until_free > config_.upload_ahead_minutes * 60) {
+            return;
+        }
+    }
+    QueuedJob job;
+    if (!ClaimNextJob(printer, kStagedStatus, &job)) {
+        return;
+    }
+    if (!PostUpload(printer, job, true)) {
+        RequeueJob(job);
+        return;
+    }
+    printer.staged_job = job;
+    printer.staging = StagingState::Uploading;
+}
+
+// Progress reports arrive about once a second, so this only reads the queue when
+// the printer enters the window, when the coordinator has requeued a job since
+// the last look, or after kStageRecheckInterval.
+void PrinterCoordinator::StageWithinWindow(PrinterSession &printer,
+                                           std::chrono::steady_clock::time_point now) {
+    const int64_t until_free = timeline_.GetSecondsUntilFree(printer.key);
+    const bool in_window = printer.dispatch_state == DispatchState::Confirmed &&
+                           until_free >= 0 && until_free <= config_.upload_ahead_minutes * 60;
+    const bool entered = in_window && !printer.in_stage_window;
+    printer.in_stage_window = in_window;
+    if (!in_window || printer.staging != StagingState::None) {
+        return;
+    }
+    if (!entered && printer.stage_checked_generation == queue_generation_ &&
+        now - printer.stage_checked_at < kStageRecheckInterval) {
+        return;
+    }
+    printer.stage_checked_generation = queue_generation_;
+    printer.stage_checked_at = now;
+    StageNextJob(printer);
+}
+
+void PrinterCoordinator::HandleStagedUploadFinished(PrinterSession &printer,
+                                                    const QueuedJob &job,
+                                                    bool uploaded,
+                                                    const wxString &upload_error) {
+    // A dispatch that found this upload in flight is waiting in Uploading for it.
+    const bool dispatch_waiting = printer.dispatch_state == DispatchState::Uploading;
+    printer.staging = StagingState::None;
+    if (!uploaded) {
+        wxLogWarning("PrinterCoordinator: pre-staging job %d on %s failed: %s",
+                     job.id,
+                     printer.definition.name,
+                     upload_error);
+        RequeueJob(job);
+        if (dispatch_waiting &&
+            TransitionDispatch(printer, {DispatchState::Uploading}, DispatchState::Idle)) {
+            DeferDispatch(printer);
+        }
+        return;
+    }
+    if (dispatch_waiting) {
+        HandleUploadFinished(printer, job, true, wxEmptyString);
+        return;
+    }
+    printer.staged_job = job;
+    printer.staging = StagingState::Ready;
+    wxLogMessage("PrinterCoordinator: pre-staged job %d on %s", job.id, printer.definition.name);
+}
+
+void PrinterCoordinator::HandleUploadFinished(PrinterSession &printer,
+                                              const QueuedJob &job,
+                                              bool uploaded,
+                                              const wxString &upload_error) {
+    if (!uploaded) {
+        wxLogWarning("PrinterCoordinator: FTPS upload of job %d to %s failed: %s",
+                     job.id,
+                     printer.definition.name,
+                     upload_error);
+        RequeueJob(job);
+        TransitionDispatch(printer, {DispatchState::Uploading}, DispatchState::Idle);
+        DeferDispatch(printer);
+        return;
+    }
+
+    const wxString remote_name = wxFileName(job.file_path).GetFullName();
+    PrinterState state;
+    state_store_.GetState(printer.key, &state);
+    const std::string ams_mapping = BuildAmsMapping(job.filaments, state.ams_trays);
+    const uint64_t sequence_id = PrinterCommandChannel::NextSequenceId();
     wxString publish_error;
-    if (!printer.mqtt.Publish(printer.definition.host,
-                              printer.definition.access_code,
-                              command_topic,
-                              payload,
-                              &publish_error)) {
+    if (!printer.commands.Send(
+            "project_file",
+            sequence_id,
+            BuildProjectFilePayload(remote_name, job.plate_index, ams_mapping, sequence_id),
+            [this, &printer, job_id = job.id](const CommandResult &result) {
+                CoordinatorEvent event;
+                event.type = EventType::CommandFinished;
+                event.printer = &printer;
+                event.job_id = job_id;
+                event.result = result;
+                PostEvent(std::move(event));
+            },
+            &publish_error)) {
         wxLogWarning("PrinterCoordinator: MQTT publish failed: %s", publish_error);
-        return false;
+        RequeueJob(job);
+        TransitionDispatch(printer, {DispatchState::Uploading}, DispatchState::Idle);
+        DeferDispatch(printer);
+        return;
     }
 
+    TransitionDispatch(printer, {DispatchState::Uploading}, DispatchState::Commanded);
+    printer.current_job = job;
     database_.AssignJobToPrinter(job.id, printer.printer_id, nullptr);
-    database_.UpdateJobStatus(job.id, "printing", config_.jobs_dir, config_.completed_dir, nullptr);
-    printer.is_printing = true;
+    if (SetJobStatus(job.id, "printing")) {
+        // Already marked printing, so the printer's first RUNNING report needs no write.
+        printer.tracker = JobTracker();
+        printer.tracker.file_name = remote_name.Lower();
+        printer.tracker.job_id = job.id;
+        printer.tracker.printing = true;
+        printer.tracker.awaiting_file = true;
+    }
     wxLogMessage("PrinterCoordinator: dispatched job %d to %s", job.id, printer.definition.name);
+    StageNextJob(printer);
+}
+
+// A replay drives the real job tracking, but must not change the live database or
+// move job files into completed_dir, so it only logs what it would have written.
+bool PrinterCoordinator::SetJobStatus(int job_id, const wxString &status_name) {
+    if (IsReplaying()) {
+        wxLogMessage("PrinterCoordinator: replay would set job %d to %s", job_id, status_name);
+        return true;
+    }
+    return database_.UpdateJobStatus(
+        job_id, status_name, config_.jobs_dir, config_.completed_dir, nullptr);
+}
+
+// Dispatch assigns every job it starts to its printer. A job the user pinned keeps
+// that printer; any other goes back to the whole farm rather than waiting on the
+// printer that just gave it up.
+void PrinterCoordinator::RequeueJob(const QueuedJob &job) {
+    if (!SetJobStatus(job.id, "queued")) {
+        return;
+    }
+    if (job.printer_id == 0 && !IsReplaying()) {
+        database_.AssignJobToPrinter(job.id, 0, nullptr);
+    }
+    AddQueuedJob(job);
+    ++queue_generation_;
+}
+
+void PrinterCoordinator::HandleDispatchResult(PrinterSession &printer,
+                                              int job_id,
+                                              const CommandResult &result) {
+    const double latency_ms = static_cast<double>(result.latency.count()) / 1000.0;
+    if (result.status == CommandStatus::Acknowledged) {
+        wxLogMessage("PrinterCoordinator: %s accepted job %d in %.1f ms",
+                     printer.definition.name,
+                     job_id,
+                     latency_ms);
+        TransitionDispatch(printer, {DispatchState::Commanded}, DispatchState::Confirmed);
+        return;
+    }
+    if (result.status == CommandStatus::TimedOut) {
+        wxLogWarning("PrinterCoordinator: %s did not acknowledge job %d after %.1f ms",
+                     printer.definition.name,
+                     job_id,
+                     latency_ms);
+        if (printer.dispatch_state != DispatchState::Commanded ||
+            printer.current_job.id != job_id || printer.tracker.started) {
+            return;
+        }
+        // The printer may have started anyway. Ask for a full report and give it
+        // until the deadline to show the job starting.
+        wxString publish_error;
+        if (!PublishRequest(printer, BuildPushAllPayload(), &publish_error)) {
+            wxLogWarning("PrinterCoordinator: pushall to %s failed: %s",
+                         printer.definition.name,
+                         publish_error);
+        }
+        printer.start_pending = true;
+        printer.start_deadline = std::chrono::steady_clock::now() + kStartDeadline;
+        return;
+    }
+    wxLogWarning("PrinterCoordinator: %s rejected job %d: %s %s",
+                 printer.definition.name,
+                 job_id,
+                 result.result,
+                 result.reason);
+    const QueuedJob job = printer.current_job;
+    if (job.id == job_id &&
+        TransitionDispatch(printer, {DispatchState::Commanded}, DispatchState::Idle)) {
+        RequeueJob(job);
+        if (printer.tracker.job_id == job_id) {
+            printer.tracker = JobTracker();
+        }
+        DeferDispatch(printer);
+    }
+}
+
+bool PrinterCoordinator::TransitionDispatch(PrinterSession &printer,
+                                            std::initializer_list<DispatchState> from,
+                                            DispatchState to) {
+    if (std::find(from.begin(), from.end(), printer.dispatch_state) == from.end()) {
+        return false;
+    }
+    printer.dispatch_state = to;
+    if (to == DispatchState::Idle) {
+        printer.current_job = QueuedJob();
+        printer.start_pending = false;
+    }
     return true;
 }
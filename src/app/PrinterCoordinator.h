@@ -1,33 +1,261 @@
 #pragma once
 
 #include "app/AppConfig.h"
+#include "app/CommandBroadcast.h"
 #include "app/DatabaseManager.h"
+#include "app/FilamentCompatibility.h"
 #include "app/FtpsClient.h"
+#include "app/JobScheduler.h"
+#include "app/MpscQueue.h"
 #include "app/MqttClient.h"
+#include "app/MqttReactor.h"
+#include "app/PrinterCommandChannel.h"
+#include "app/PrinterStateStore.h"
+#include "app/PrinterTimeline.h"
+#include "app/RemoteFileCache.h"
+#include "app/ReportFields.h"
+#include "app/ReportRecording.h"
+#include "app/WorkerPool.h"
 
+#include <wx/event.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
 #include <memory>
 #include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class FarmCommand {
+    PushAll,
+    Pause,
+    Resume,
+    Stop,
+    LightOn,
+    LightOff,
+};
+
+// Where a printer is in taking its next job. Only the upload itself runs on the
+// upload workers; every transition happens on the coordinator thread. Only an
+// Idle printer starts a dispatch, so triggers that arrive while one is under
+// way are ignored.
+enum class DispatchState {
+    Idle,
+    Uploading,
+    Commanded,
+    Confirmed,
+};
+
+// Upload-ahead of the job a printer will take next, while its current print runs.
+enum class StagingState {
+    None,
+    Uploading,
+    Ready,
+};
 
-class PrinterCoordinator {
+class PrinterCoordinator : public wxEvtHandler {
 public:
+    using CommandCompletion = PrinterCommandChannel::CompletionHandler;
+
     PrinterCoordinator(const AppConfig &config, DatabaseManager &database);
     ~PrinterCoordinator();
 
     bool Start(wxString *error_message);
+    std::map<wxString, CommandLatencyStats> GetCommandStats() const;
+    PrinterStateStore &GetStateStore();
+    const PrinterTimeline &GetTimeline() const;
+
+    // Control commands go through the printer's priority lane ahead of queued bulk
+    // commands. |handler| may be empty; it receives the issue-to-ack latency.
+    bool PausePrint(const wxString &printer_key,
+                    CommandCompletion handler,
+                    wxString *error_message);
+    bool ResumePrint(const wxString &printer_key,
+                     CommandCompletion handler,
+                     wxString *error_message);
+    bool StopPrint(const wxString &printer_key,
+                   CommandCompletion handler,
+                   wxString *error_message);
+    bool SetChamberLight(const wxString &printer_key,
+                         bool on,
+                         CommandCompletion handler,
+                         wxString *error_message);
+    // Sends |command| to every printer in |printer_keys| (all printers when empty)
+    // concurrently and returns without waiting. |handler| runs once, on whichever
+    // thread completes the last printer, after the slowest one acknowledges,
+    // rejects or times out. A pushall has no acknowledgement and counts as
+    // published once sent. Sends still queued when the coordinator stops complete
+    // as cancelled.
+    bool Broadcast(FarmCommand command,
+                   const std::vector<wxString> &printer_keys,
+                   CommandBroadcast::Completion handler,
+                   wxString *error_message);
 
 private:
+    struct PrinterSession;
+
+    // Work handed to the coordinator thread. Reports are parsed and merged into the
+    // state store on the reader threads; anything that reads or writes the
+    // database or a printer's dispatch state arrives here instead.
+    enum class EventType {
+        Connected,
+        StateChanged,
+        UploadFinished,
+        CommandFinished,
+    };
+
+    struct CoordinatorEvent {
+        EventType type = EventType::StateChanged;
+        PrinterSession *printer = nullptr;
+        QueuedJob job;
+        // The upload was the printer's next job, sent ahead of time.
+        bool staged = false;
+        bool uploaded = false;
+        wxString upload_error;
+        int job_id = 0;
+        CommandResult result;
+    };
+
+    // What the printer's reports have been taken to mean for the job it holds.
+    // Reports only reach the database when they change this.
+    struct JobTracker {
+        // The raw gcode_file last reported, and the lower-cased file name it gave.
+        std::string gcode_file;
+        wxString file_name;
+        GcodeState gcode_state = GcodeState::Unknown;
+        // 0 when the file matches no active job.
+        int job_id = 0;
+        bool printing = false;
+        // Whether PREPARE or RUNNING has been seen for this job. A job seeded at
+        // dispatch starts out false: until then FINISH, FAILED and IDLE, even for a
+        // reprint under the same name, are left over from the previous print.
+        bool started = false;
+        // Seeded at dispatch: until the printer names this file, its reports still
+        // describe the previous print and are not looked up.
+        bool awaiting_file = false;
+        // IDLE only ends a job once it has held for a while.
+        bool idle_pending = false;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
     struct PrinterSession {
         PrinterDefinition definition;
+        wxString key;
         int printer_id = 0;
-        bool is_printing = false;
+        // Owned by the coordinator thread.
+        DispatchState dispatch_state = DispatchState::Idle;
+        // The job being uploaded or printed; cleared when the printer goes Idle.
+        QueuedJob current_job;
+        // Set when the print command went unacknowledged: unless the printer reports
+        // the job starting by start_deadline, it is taken back; see CheckStartDeadlines.
+        bool start_pending = false;
+        std::chrono::steady_clock::time_point start_deadline;
+        // Set after a failed dispatch: the printer asks for work again at retry_at.
+        bool retry_pending = false;
+        std::chrono::steady_clock::time_point retry_at;
+        StagingState staging = StagingState::None;
+        QueuedJob staged_job;
+        // When the queue was last read for an upload-ahead window; see StageWithinWindow.
+        bool in_stage_window = false;
+        uint64_t stage_checked_generation = 0;
+        std::chrono::steady_clock::time_point stage_checked_at;
+        JobTracker tracker;
+        // Shared with the upload workers.
+        RemoteFileCache file_cache;
         MqttClient mqtt;
+        PrinterCommandChannel commands;
     };
 
-    void HandleReport(PrinterSession &printer, const wxString &payload);
-    bool DispatchNextJob(PrinterSession &printer);
+    bool UsesBroker() const;
+    bool IsReplaying() const;
+    bool StartBrokerSession(wxString *error_message);
+    void ReplayRecording();
+    void PostEvent(CoordinatorEvent event);
+    void RunEventLoop();
+    void HandleEvents(std::vector<CoordinatorEvent> *events);
+    void ExpireCommands(std::chrono::steady_clock::time_point now);
+    void HandleConnected(PrinterSession &printer);
+    bool PublishRequest(PrinterSession &printer, std::string_view payload, wxString *error_message);
+    void HandleReport(PrinterSession &printer, std::string_view payload);
+    void HandleStateChange(PrinterSession &printer,
+                           const PrinterState &state,
+                           std::chrono::steady_clock::time_point now);
+    void LookupTrackedJob(PrinterSession &printer);
+    void FinishTrackedJob(PrinterSession &printer, const char *status_name);
+    void SettleIdleReports(std::chrono::steady_clock::time_point now);
+    void CheckStartDeadlines(std::chrono::steady_clock::time_point now);
+    void RetryDispatches(std::chrono::steady_clock::time_point now);
+    void DeferDispatch(PrinterSession &printer);
+    void RequestDispatch(PrinterSession &printer);
+    bool RefreshQueue();
+    void AddQueuedJob(const QueuedJob &job);
+    bool ClaimNextJob(PrinterSession &printer, const wxString &status_name, QueuedJob *job);
+    std::vector<SchedulerPrinter> PredictAvailability(const PrinterSession &requester) const;
+    bool ReleaseStagedJob(const PrinterSession &requester,
+                          const wxString &status_name,
+                          QueuedJob *job);
+    bool PostUpload(PrinterSession &printer, const QueuedJob &job, bool staged);
+    bool UploadJobFile(PrinterSession &printer, const QueuedJob &job, wxString *error_message);
+    void TrimRemoteFiles(PrinterSession &printer);
+    void StageNextJob(PrinterSession &printer);
+    void StageWithinWindow(PrinterSession &printer, std::chrono::steady_clock::time_point now);
+    void HandleStagedUploadFinished(PrinterSession &printer,
+                                    const QueuedJob &job,
+                                    bool uploaded,
+                                    const wxString &upload_error);
+    void HandleUploadFinished(PrinterSession &printer,
+                              const QueuedJob &job,
+                              bool uploaded,
+                              const wxString &upload_error);
+    bool SetJobStatus(int job_id, const wxString &status_name);
+    void RequeueJob(const QueuedJob &job);
+    void HandleDispatchResult(PrinterSession &printer, int job_id, const CommandResult &result);
+    // Moves |printer| to |to| only if it is currently in one of |from|.
+    bool TransitionDispatch(PrinterSession &printer,
+                            std::initializer_list<DispatchState> from,
+                            DispatchState to);
+    bool SendControlCommand(PrinterSession &printer,
+                            FarmCommand command,
+                            CommandCompletion handler,
+                            wxString *error_message);
+    bool SendControlCommand(const wxString &printer_key,
+                            FarmCommand command,
+                            CommandCompletion handler,
+                            wxString *error_message);
 
     const AppConfig &config_;
     DatabaseManager &database_;
     FtpsClient ftps_client_;
+    JobScheduler scheduler_;
+    // Coordinator thread only.
+    CompatibilityMatrix compatibility_;
+    // Bumped whenever the coordinator puts a job back in the queue.
+    uint64_t queue_generation_ = 0;
+    // The queued jobs in id order, kept in step with the database; see RefreshQueue.
+    std::vector<QueuedJob> queue_;
+    bool queue_loaded_ = false;
+    int queue_last_id_ = 0;
+    uint64_t queue_import_count_ = 0;
+    WorkerPool upload_workers_;
+    // Kept apart from the uploads so a command never waits behind a file transfer.
+    WorkerPool command_workers_;
+    MqttReactor reactor_;
+    PrinterStateStore state_store_;
+    PrinterTimeline timeline_;
+    MqttClient broker_mqtt_;
     std::map<wxString, PrinterSession> sessions_;
+    std::unordered_map<std::string, PrinterSession *> sessions_by_serial_;
+    ReportRecorder report_recorder_;
+    std::atomic<bool> replay_cancelled_{false};
+    std::thread replay_thread_;
+    MpscQueue<CoordinatorEvent> events_;
+    std::atomic<bool> event_loop_stopping_{false};
+    // StateChanged events folded into an earlier one in the same batch.
+    std::atomic<uint64_t> coalesced_state_changes_{0};
+    std::thread event_loop_thread_;
 };
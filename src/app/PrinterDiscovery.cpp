@@ -0,0 +1,280 @@
+#include "app/PrinterDiscovery.h"
+
+#include <wx/log.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <string>
+
+namespace {
+constexpr char kSsdpMulticastGroup[] = "239.255.255.250";
+constexpr char kBambuSearchTarget[] = "urn:bambulab-com:device:3dprinter:1";
+constexpr std::string_view kBambuDeviceMarker = "bambulab-com:device:3dprinter";
+constexpr size_t kMaxDatagram = 2048;
+
+bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) ==
+                      std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+std::string_view Trim(std::string_view value) {
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front()))) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back()))) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+// Location is a bare IP on current firmware but a URL on some older builds.
+std::string_view HostFromLocation(std::string_view location) {
+    const size_t scheme = location.find("://");
+    if (scheme != std::string_view::npos) {
+        location.remove_prefix(scheme + 3);
+    }
+    const size_t end = location.find_first_of(":/");
+    return end == std::string_view::npos ? location : location.substr(0, end);
+}
+
+wxString ToWxString(std::string_view value) {
+    return wxString::FromUTF8(value.data(), value.size());
+}
+
+std::string BuildSearchRequest(const DiscoveryEndpoint &target) {
+    return "M-SEARCH * HTTP/1.1\r\n"
+           "HOST: " +
+           target.host.ToStdString() + ":" + std::to_string(target.port) +
+           "\r\n"
+           "MAN: \"ssdp:discover\"\r\n"
+           "MX: 1\r\n"
+           "ST: " +
+           kBambuSearchTarget + "\r\n\r\n";
+}
+
+int OpenUdpSocket(int port, bool join_multicast, wxString *error_message) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        if (error_message) {
+            *error_message = wxString::Format("socket failed: %s", std::strerror(errno));
+        }
+        return -1;
+    }
+    const int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+#ifdef SO_REUSEPORT
+    // Bambu Studio may already be listening on the announcement ports.
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#endif
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        if (error_message) {
+            *error_message =
+                wxString::Format("bind to UDP port %d failed: %s", port, std::strerror(errno));
+        }
+        close(fd);
+        return -1;
+    }
+    if (join_multicast) {
+        ip_mreq membership{};
+        inet_pton(AF_INET, kSsdpMulticastGroup, &membership.imr_multiaddr);
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership));
+    }
+    return fd;
+}
+}  // namespace
+
+PrinterDiscovery::PrinterDiscovery(PrinterDiscoveryOptions options)
+    : options_(std::move(options)) {}
+
+bool PrinterDiscovery::Discover(std::vector<DiscoveredPrinter> *printers,
+                                wxString *error_message) {
+    std::vector<pollfd> sockets;
+    const int probe_fd = OpenUdpSocket(0, false, error_message);
+    if (probe_fd < 0) {
+        wxLogError("PrinterDiscovery: unable to open probe socket.");
+        return false;
+    }
+    sockets.push_back(pollfd{probe_fd, POLLIN, 0});
+    for (const int port : options_.listen_ports) {
+        wxString listen_error;
+        const int fd = OpenUdpSocket(port, true, &listen_error);
+        if (fd < 0) {
+            wxLogWarning("PrinterDiscovery: not listening for announcements: %s", listen_error);
+            continue;
+        }
+        sockets.push_back(pollfd{fd, POLLIN, 0});
+    }
+
+    std::vector<std::pair<sockaddr_in, std::string>> probes;
+    for (const auto &target : options_.probe_targets) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(target.port));
+        if (inet_pton(AF_INET, target.host.ToStdString().c_str(), &address.sin_addr) != 1) {
+            wxLogWarning("PrinterDiscovery: ignoring invalid probe address %s", target.host);
+            continue;
+        }
+        probes.emplace_back(address, BuildSearchRequest(target));
+    }
+
+    std::map<wxString, DiscoveredPrinter> found;
+    const auto deadline = std::chrono::steady_clock::now() + options_.timeout;
+    auto next_probe = std::chrono::steady_clock::now();
+    char datagram[kMaxDatagram];
+    while (true) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        if (now >= next_probe) {
+            for (const auto &probe : probes) {
+                sendto(probe_fd,
+                       probe.second.data(),
+                       probe.second.size(),
+                       0,
+                       reinterpret_cast<const sockaddr *>(&probe.first),
+                       sizeof(probe.first));
+            }
+            next_probe = now + options_.probe_interval;
+        }
+
+        const auto wait = std::min(deadline, next_probe) - now;
+        const int wait_ms = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()) + 1;
+        if (poll(sockets.data(), sockets.size(), wait_ms) <= 0) {
+            continue;
+        }
+        for (auto &entry : sockets) {
+            if ((entry.revents & POLLIN) == 0) {
+                continue;
+            }
+            sockaddr_in sender{};
+            socklen_t sender_length = sizeof(sender);
+            const ssize_t bytes = recvfrom(entry.fd,
+                                           datagram,
+                                           sizeof(datagram),
+                                           0,
+                                           reinterpret_cast<sockaddr *>(&sender),
+                                           &sender_length);
+            if (bytes <= 0) {
+                continue;
+            }
+            char sender_text[INET_ADDRSTRLEN] = {};
+            inet_ntop(AF_INET, &sender.sin_addr, sender_text, sizeof(sender_text));
+            DiscoveredPrinter printer;
+            if (ParseSsdpAnnouncement(std::string_view(datagram, static_cast<size_t>(bytes)),
+                                      sender_text,
+                                      &printer)) {
+                found[printer.serial] = printer;
+            }
+        }
+    }
+
+    for (const auto &entry : sockets) {
+        close(entry.fd);
+    }
+    printers->clear();
+    for (const auto &entry : found) {
+        printers->push_back(entry.second);
+    }
+    wxLogMessage("PrinterDiscovery: found %zu printers", printers->size());
+    return true;
+}
+
+bool ParseSsdpAnnouncement(std::string_view message,
+                           const wxString &sender_address,
+                           DiscoveredPrinter *printer) {
+    const size_t first_line_end = message.find('\n');
+    const std::string_view first_line = Trim(message.substr(0, first_line_end));
+    // Our own M-SEARCH probes loop back on the multicast listeners.
+    if (first_line.substr(0, 8) == "M-SEARCH" || first_line_end == std::string_view::npos) {
+        return false;
+    }
+
+    DiscoveredPrinter parsed;
+    bool is_printer = false;
+    std::string_view location;
+    size_t line_start = first_line_end + 1;
+    while (line_start < message.size()) {
+        size_t line_end = message.find('\n', line_start);
+        if (line_end == std::string_view::npos) {
+            line_end = message.size();
+        }
+        const std::string_view line = message.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        const std::string_view name = Trim(line.substr(0, colon));
+        const std::string_view value = Trim(line.substr(colon + 1));
+        if (EqualsIgnoreCase(name, "NT") || EqualsIgnoreCase(name, "ST")) {
+            is_printer = is_printer || value.find(kBambuDeviceMarker) != std::string_view::npos;
+        } else if (EqualsIgnoreCase(name, "USN")) {
+            parsed.serial = ToWxString(value);
+        } else if (EqualsIgnoreCase(name, "Location")) {
+            location = HostFromLocation(value);
+        } else if (EqualsIgnoreCase(name, "DevModel.bambu.com")) {
+            parsed.model = ToWxString(value);
+        } else if (EqualsIgnoreCase(name, "DevName.bambu.com")) {
+            parsed.name = ToWxString(value);
+        } else if (EqualsIgnoreCase(name, "DevConnect.bambu.com")) {
+            parsed.lan_only = EqualsIgnoreCase(value, "lan");
+        }
+    }
+    if (!is_printer || parsed.serial.empty()) {
+        return false;
+    }
+    parsed.host = location.empty() ? sender_address : ToWxString(location);
+    *printer = parsed;
+    return true;
+}
+
+size_t MergeDiscoveredPrinters(const std::vector<DiscoveredPrinter> &discovered,
+                               std::vector<PrinterDefinition> *printers) {
+    size_t added = 0;
+    for (const auto &printer : discovered) {
+        auto it = std::find_if(printers->begin(),
+                               printers->end(),
+                               [&printer](const PrinterDefinition &existing) {
+                                   return existing.serial == printer.serial;
+                               });
+        if (it != printers->end()) {
+            it->host = printer.host;
+            if (!printer.model.empty()) {
+                it->model = printer.model;
+            }
+            continue;
+        }
+
+        PrinterDefinition definition;
+        definition.name = printer.name.empty()
+                              ? wxString::Format("%s-%s", printer.model, printer.serial.Right(4))
+                              : printer.name;
+        definition.host = printer.host;
+        definition.serial = printer.serial;
+        definition.model = printer.model;
+        printers->push_back(definition);
+        added += 1;
+    }
+    return added;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "app/AppConfig.h"
+
+#include <wx/string.h>
+
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+struct DiscoveredPrinter {
+    wxString serial;
+    wxString model;
+    wxString name;
+    wxString host;
+    bool lan_only = false;
+};
+
+struct DiscoveryEndpoint {
+    wxString host;
+    int port = 0;
+};
+
+struct PrinterDiscoveryOptions {
+    std::chrono::milliseconds timeout{3000};
+    std::chrono::milliseconds probe_interval{1000};
+    // Bambu printers announce themselves on UDP 2021 (and 1990 on older firmware).
+    std::vector<int> listen_ports{2021, 1990};
+    std::vector<DiscoveryEndpoint> probe_targets{{"239.255.255.250", 1990},
+                                                 {"255.255.255.255", 2021}};
+};
+
+// Finds LAN-mode printers by listening for their SSDP NOTIFY announcements on
+// every listen port at once while periodically sending M-SEARCH probes. Replies
+// to a probe come back on the probe socket and are collected the same way.
+class PrinterDiscovery {
+public:
+    explicit PrinterDiscovery(PrinterDiscoveryOptions options = PrinterDiscoveryOptions());
+
+    // Blocks for options.timeout and returns every printer heard from, one entry
+    // per serial.
+    bool Discover(std::vector<DiscoveredPrinter> *printers, wxString *error_message);
+
+private:
+    PrinterDiscoveryOptions options_;
+};
+
+bool ParseSsdpAnnouncement(std::string_view message,
+                           const wxString &sender_address,
+                           DiscoveredPrinter *printer);
+
+// Adds printers whose serial is not configured yet and refreshes the address and
+// model of ones that are. Returns the number of printers added.
+size_t MergeDiscoveredPrinters(const std::vector<DiscoveredPrinter> &discovered,
+                               std::vector<PrinterDefinition> *printers);
@@ -0,0 +1,763 @@
+#include "app/PrinterReport.h"
+
+#include "app/ReportFields.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace {
+constexpr int kMaxNestingDepth = 64;
+constexpr size_t kMaxNumberLength = 63;
+
+void AppendUtf8(uint32_t code_point, std::string *out) {
+    if (code_point < 0x80) {
+        out->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+bool ParseHex4(std::string_view text, size_t pos, uint32_t *value) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    uint32_t result = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        const char ch = text[pos + i];
+        result <<= 4;
+        if (ch >= '0' && ch <= '9') {
+            result |= static_cast<uint32_t>(ch - '0');
+        } else if (ch >= 'a' && ch <= 'f') {
+            result |= static_cast<uint32_t>(ch - 'a' + 10);
+        } else if (ch >= 'A' && ch <= 'F') {
+            result |= static_cast<uint32_t>(ch - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    *value = result;
+    return true;
+}
+
+// Decodes the body of a string token that JsonReader has already validated.
+void DecodeString(std::string_view raw, bool has_escapes, std::string *out) {
+    if (!has_escapes) {
+        out->assign(raw.data(), raw.size());
+        return;
+    }
+    out->clear();
+    out->reserve(raw.size());
+    for (size_t pos = 0; pos < raw.size();) {
+        const char ch = raw[pos++];
+        if (ch != '\\') {
+            out->push_back(ch);
+            continue;
+        }
+        const char escaped = raw[pos++];
+        switch (escaped) {
+        case 'b':
+            out->push_back('\b');
+            break;
+        case 'f':
+            out->push_back('\f');
+            break;
+        case 'n':
+            out->push_back('\n');
+            break;
+        case 'r':
+            out->push_back('\r');
+            break;
+        case 't':
+            out->push_back('\t');
+            break;
+        case 'u': {
+            uint32_t code_point = 0;
+            ParseHex4(raw, pos, &code_point);
+            pos += 4;
+            uint32_t low = 0;
+            if (code_point >= 0xD800 && code_point <= 0xDBFF && raw.substr(pos, 2) == "\\u" &&
+                ParseHex4(raw, pos + 2, &low)) {
+                pos += 6;
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+            }
+            AppendUtf8(code_point, out);
+            break;
+        }
+        default:
+            out->push_back(escaped);
+            break;
+        }
+    }
+}
+
+// Pull tokenizer over a single report. Values the caller does not ask for are
+// skipped in place without being materialized. Object keys are
+// returned as raw views; report keys never contain escapes. Given a structural
+// index, whitespace runs and escape-free strings are crossed in one jump.
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view input, const JsonStructuralIndex *index = nullptr)
+        : input_(input), index_(index) {}
+
+    bool Failed() const { return failed_; }
+
+    char Peek() {
+        SkipWhitespace();
+        return pos_ < input_.size() ? input_[pos_] : '\0';
+    }
+
+    bool AtEnd() { return Peek() == '\0' && pos_ == input_.size(); }
+
+    bool BeginObject() { return Expect('{'); }
+
+    bool BeginArray() { return Expect('['); }
+
+    // Advances to the next member of the current object. Returns false once the
+    // closing brace has been consumed or on a syntax error (see Failed()).
+    bool NextMember(bool *first, std::string_view *key) {
+        if (!NextItem('}', first)) {
+            return false;
+        }
+        bool has_escapes = false;
+        if (!ReadRawString(key, &has_escapes) || !Expect(':')) {
+            return Fail();
+        }
+        return true;
+    }
+
+    bool NextElement(bool *first) { return NextItem(']', first); }
+
+    bool ReadRawString(std::string_view *raw, bool *has_escapes) {
+        if (Peek() != '"') {
+            return Fail();
+        }
+        const size_t start = ++pos_;
+        *has_escapes = false;
+        if (index_ && SeekIndex(start) && input_[(*index_)[index_cursor_]] == '"') {
+            const size_t end = (*index_)[index_cursor_];
+            if (!index_->HasBackslash() ||
+                !std::memchr(input_.data() + start, '\\', end - start)) {
+                *raw = input_.substr(start, end - start);
+                pos_ = end + 1;
+                return true;
+            }
+        }
+        while (pos_ < input_.size()) {
+            const char ch = input_[pos_++];
+            if (ch == '"') {
+                *raw = input_.substr(start, pos_ - start - 1);
+                return true;
+            }
+            if (ch != '\\') {
+                continue;
+            }
+            *has_escapes = true;
+            if (pos_ >= input_.size()) {
+                break;
+            }
+            const char escaped = input_[pos_++];
+            if (escaped == 'u') {
+                uint32_t code_point = 0;
+                if (!ParseHex4(input_, pos_, &code_point)) {
+                    break;
+                }
+                pos_ += 4;
+            } else if (escaped != '"' && escaped != '\\' && escaped != '/' && escaped != 'b' &&
+                       escaped != 'f' && escaped != 'n' && escaped != 'r' && escaped != 't') {
+                break;
+            }
+        }
+        return Fail();
+    }
+
+    bool ReadString(std::string *out) {
+        std::string_view raw;
+        bool has_escapes = false;
+        if (!ReadRawString(&raw, &has_escapes)) {
+            return false;
+        }
+        DecodeString(raw, has_escapes, out);
+        return true;
+    }
+
+    bool ReadNumberToken(std::string_view *token) {
+        SkipWhitespace();
+        const size_t start = pos_;
+        while (pos_ < input_.size()) {
+            const char ch = input_[pos_];
+            if ((ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' ||
+                ch == 'E') {
+                ++pos_;
+                continue;
+            }
+            break;
+        }
+        if (pos_ == start) {
+            return Fail();
+        }
+        *token = input_.substr(start, pos_ - start);
+        return true;
+    }
+
+    bool SkipValue() {
+        const char ch = Peek();
+        if (ch == '{' || ch == '[') {
+            return SkipContainer();
+        }
+        if (ch == '"') {
+            std::string_view raw;
+            bool has_escapes = false;
+            return ReadRawString(&raw, &has_escapes);
+        }
+        if (ch == 't') {
+            return ConsumeLiteral("true");
+        }
+        if (ch == 'f') {
+            return ConsumeLiteral("false");
+        }
+        if (ch == 'n') {
+            return ConsumeLiteral("null");
+        }
+        std::string_view token;
+        return ReadNumberToken(&token) && (IsNumber(token) || Fail());
+    }
+
+    // Accepts exactly the tokens ParseNumber accepts, without converting them.
+    static bool IsNumber(std::string_view token) {
+        size_t pos = 0;
+        auto digits = [&token, &pos]() {
+            const size_t start = pos;
+            while (pos < token.size() && token[pos] >= '0' && token[pos] <= '9') {
+                ++pos;
+            }
+            return pos - start;
+        };
+        if (token.size() > kMaxNumberLength) {
+            return false;
+        }
+        if (pos < token.size() && (token[pos] == '-' || token[pos] == '+')) {
+            ++pos;
+        }
+        size_t mantissa = digits();
+        if (pos < token.size() && token[pos] == '.') {
+            ++pos;
+            mantissa += digits();
+        }
+        if (mantissa == 0) {
+            return false;
+        }
+        if (pos < token.size() && (token[pos] == 'e' || token[pos] == 'E')) {
+            ++pos;
+            if (pos < token.size() && (token[pos] == '-' || token[pos] == '+')) {
+                ++pos;
+            }
+            if (digits() == 0) {
+                return false;
+            }
+        }
+        return pos == token.size();
+    }
+
+    static bool ParseNumber(std::string_view token, double *out) {
+        if (token.empty() || token.size() > kMaxNumberLength) {
+            return false;
+        }
+        char buffer[kMaxNumberLength + 1];
+        token.copy(buffer, token.size());
+        buffer[token.size()] = '\0';
+        char *end = nullptr;
+        *out = std::strtod(buffer, &end);
+        return end == buffer + token.size();
+    }
+
+private:
+    // Skipped containers are only checked for terminated strings and balanced,
+    // correctly paired brackets; nothing inside them is tokenized.
+    bool SkipContainer() {
+        uint64_t objects = 0;
+        int depth = 0;
+        if (index_) {
+            for (SeekIndex(pos_); index_cursor_ < index_->size(); ++index_cursor_) {
+                const size_t at = (*index_)[index_cursor_];
+                if (!TrackBracket(input_[at], &objects, &depth)) {
+                    return Fail();
+                }
+                if (depth == 0) {
+                    pos_ = at + 1;
+                    return true;
+                }
+            }
+            return Fail();
+        }
+        while (pos_ < input_.size()) {
+            const char ch = input_[pos_++];
+            if (ch == '"') {
+                while (pos_ < input_.size() && input_[pos_] != '"') {
+                    pos_ += input_[pos_] == '\\' ? 2 : 1;
+                }
+                if (pos_++ >= input_.size()) {
+                    break;
+                }
+            } else if (ch == '\\') {
+                // Matches the structural index, which lets a backslash hide the
+                // next quote even outside strings.
+                if (pos_ < input_.size() && (input_[pos_] == '"' || input_[pos_] == '\\')) {
+                    ++pos_;
+                }
+            } else if (!TrackBracket(ch, &objects, &depth)) {
+                break;
+            } else if (depth == 0) {
+                return true;
+            }
+        }
+        return Fail();
+    }
+
+    // |objects| holds one bit per open bracket, set for braces.
+    static bool TrackBracket(char ch, uint64_t *objects, int *depth) {
+        switch (ch) {
+        case '{':
+        case '[':
+            if (*depth == kMaxNestingDepth) {
+                return false;
+            }
+            *objects = (*objects << 1) | (ch == '{' ? 1 : 0);
+            *depth += 1;
+            return true;
+        case '}':
+        case ']':
+            if (*depth == 0 || ((*objects & 1) != 0) != (ch == '}')) {
+                return false;
+            }
+            *objects >>= 1;
+            *depth -= 1;
+            return true;
+        default:
+            return true;
+        }
+    }
+
+    // Moves the index cursor to the first entry at or after |pos|.
+    bool SeekIndex(size_t pos) {
+        while (index_cursor_ < index_->size() && (*index_)[index_cursor_] < pos) {
+            ++index_cursor_;
+        }
+        return index_cursor_ < index_->size();
+    }
+
+    static bool IsWhitespace(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+    }
+
+    void SkipWhitespace() {
+        // Outside strings the first byte after whitespace always starts a token,
+        // and every token start is indexed.
+        if (index_ && pos_ < input_.size() && IsWhitespace(input_[pos_])) {
+            pos_ = SeekIndex(pos_) ? (*index_)[index_cursor_] : input_.size();
+            return;
+        }
+        while (pos_ < input_.size() && IsWhitespace(input_[pos_])) {
+            ++pos_;
+        }
+    }
+
+    bool Fail() {
+        failed_ = true;
+        return false;
+    }
+
+    bool Expect(char expected) {
+        if (Peek() != expected) {
+            return Fail();
+        }
+        ++pos_;
+        return true;
+    }
+
+    bool ConsumeLiteral(std::string_view literal) {
+        if (input_.substr(pos_, literal.size()) != literal) {
+            return Fail();
+        }
+        pos_ += literal.size();
+        return true;
+    }
+
+    bool NextItem(char close, bool *first) {
+        if (failed_) {
+            return false;
+        }
+        const char ch = Peek();
+        if (ch == close) {
+            ++pos_;
+            return false;
+        }
+        if (!*first) {
+            if (ch != ',') {
+                return Fail();
+            }
+            ++pos_;
+        }
+        *first = false;
+        return true;
+    }
+
+    std::string_view input_;
+    const JsonStructuralIndex *index_ = nullptr;
+    size_t index_cursor_ = 0;
+    size_t pos_ = 0;
+    bool failed_ = false;
+};
+
+bool ReadString(JsonReader *reader, std::optional<std::string> *out) {
+    if (reader->Peek() != '"') {
+        *out = std::nullopt;
+        return reader->SkipValue();
+    }
+    std::string value;
+    if (!reader->ReadString(&value)) {
+        return false;
+    }
+    *out = std::move(value);
+    return true;
+}
+
+// Bambu firmware sends some integers (AMS ids, tray_now) as quoted strings.
+bool ReadNumber(JsonReader *reader, std::optional<double> *out) {
+    *out = std::nullopt;
+    const char ch = reader->Peek();
+    std::string_view token;
+    std::string decoded;
+    if (ch == '"') {
+        bool has_escapes = false;
+        if (!reader->ReadRawString(&token, &has_escapes)) {
+            return false;
+        }
+        if (has_escapes) {
+            DecodeString(token, true, &decoded);
+            token = decoded;
+        }
+    } else if (ch == '{' || ch == '[' || ch == 't' || ch == 'f' || ch == 'n') {
+        return reader->SkipValue();
+    } else if (!reader->ReadNumberToken(&token)) {
+        return false;
+    }
+    double number = 0.0;
+    if (JsonReader::ParseNumber(token, &number)) {
+        *out = number;
+    } else if (ch != '"') {
+        return false;
+    }
+    return true;
+}
+
+// Reports come off the network, so a number may be NaN or far outside |T|; casting
+// one of those is undefined, and the field is dropped instead.
+template <typename T>
+std::optional<T> CheckedNumber(std::optional<double> number) {
+    if (!number || !(*number >= static_cast<double>(std::numeric_limits<T>::min()) &&
+                     *number <= static_cast<double>(std::numeric_limits<T>::max()))) {
+        return std::nullopt;
+    }
+    return static_cast<T>(*number);
+}
+
+bool ReadInt(JsonReader *reader, std::optional<int> *out) {
+    std::optional<double> number;
+    if (!ReadNumber(reader, &number)) {
+        return false;
+    }
+    *out = CheckedNumber<int>(number);
+    return true;
+}
+
+bool ReadTray(JsonReader *reader, int ams_id, std::vector<AmsTrayState> *trays) {
+    if (reader->Peek() != '{') {
+        return reader->SkipValue();
+    }
+    reader->BeginObject();
+    AmsTrayState state;
+    state.ams_id = ams_id;
+    std::optional<int> tray_id;
+    std::optional<int> remain;
+    std::optional<std::string> material;
+    std::optional<std::string> color;
+    bool first = true;
+    std::string_view key;
+    while (reader->NextMember(&first, &key)) {
+        bool ok = true;
+        switch (LookupReportField(key)) {
+        case ReportField::Id:
+            ok = ReadInt(reader, &tray_id);
+            break;
+        case ReportField::TrayType:
+            ok = ReadString(reader, &material);
+            break;
+        case ReportField::TrayColor:
+            ok = ReadString(reader, &color);
+            break;
+        case ReportField::Remain:
+            ok = ReadInt(reader, &remain);
+            break;
+        default:
+            ok = reader->SkipValue();
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    state.tray_id = tray_id.value_or(0);
+    state.material = material.value_or("");
+    state.color = color.value_or("");
+    state.remain_percent = remain.value_or(-1);
+    trays->push_back(std::move(state));
+    return !reader->Failed();
+}
+
+// A unit's trays are buffered until the whole unit is read because "id" may
+// follow "tray".
+bool ReadAmsUnit(JsonReader *reader, std::vector<AmsTrayState> *trays) {
+    if (reader->Peek() != '{') {
+        return reader->SkipValue();
+    }
+    reader->BeginObject();
+    std::optional<int> ams_id;
+    std::vector<AmsTrayState> unit_trays;
+    bool has_trays = false;
+    bool first = true;
+    std::string_view key;
+    while (reader->NextMember(&first, &key)) {
+        bool ok = true;
+        const ReportField field = LookupReportField(key);
+        if (field == ReportField::Id) {
+            ok = ReadInt(reader, &ams_id);
+        } else if (field == ReportField::Tray && reader->Peek() == '[') {
+            has_trays = true;
+            reader->BeginArray();
+            bool first_tray = true;
+            while (ok && reader->NextElement(&first_tray)) {
+                ok = ReadTray(reader, 0, &unit_trays);
+            }
+            ok = ok && !reader->Failed();
+        } else {
+            ok = reader->SkipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (reader->Failed()) {
+        return false;
+    }
+    if (has_trays) {
+        for (auto &tray : unit_trays) {
+            tray.ams_id = ams_id.value_or(0);
+            trays->push_back(std::move(tray));
+        }
+    }
+    return true;
+}
+
+bool ReadAms(JsonReader *reader, PrinterReport *report) {
+    if (reader->Peek() != '{') {
+        return reader->SkipValue();
+    }
+    reader->BeginObject();
+    bool first = true;
+    std::string_view key;
+    while (reader->NextMember(&first, &key)) {
+        bool ok = true;
+        const ReportField field = LookupReportField(key);
+        if (field == ReportField::TrayNow) {
+            ok = ReadInt(reader, &report->ams_tray_now);
+        } else if (field == ReportField::Ams && reader->Peek() == '[') {
+            reader->BeginArray();
+            std::vector<AmsTrayState> trays;
+            bool first_unit = true;
+            while (ok && reader->NextElement(&first_unit)) {
+                ok = ReadAmsUnit(reader, &trays);
+            }
+            report->ams_trays = std::move(trays);
+        } else {
+            ok = reader->SkipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return !reader->Failed();
+}
+
+bool ReadHms(JsonReader *reader, PrinterReport *report) {
+    if (reader->Peek() != '[') {
+        return reader->SkipValue();
+    }
+    reader->BeginArray();
+    std::vector<HmsCode> codes;
+    bool first_entry = true;
+    while (reader->NextElement(&first_entry)) {
+        HmsCode code;
+        if (reader->Peek() != '{') {
+            if (!reader->SkipValue()) {
+                return false;
+            }
+            codes.push_back(code);
+            continue;
+        }
+        reader->BeginObject();
+        bool first = true;
+        std::string_view key;
+        while (reader->NextMember(&first, &key)) {
+            const ReportField field = LookupReportField(key);
+            if (field != ReportField::Attr && field != ReportField::Code) {
+                if (!reader->SkipValue()) {
+                    return false;
+                }
+                continue;
+            }
+            std::optional<double> value;
+            if (!ReadNumber(reader, &value)) {
+                return false;
+            }
+            if (const std::optional<uint32_t> number = CheckedNumber<uint32_t>(value)) {
+                (field == ReportField::Attr ? code.attr : code.code) = *number;
+            }
+        }
+        codes.push_back(code);
+    }
+    report->hms = std::move(codes);
+    return !reader->Failed();
+}
+
+bool ReadPrintField(JsonReader *reader, ReportField field, PrinterReport *report) {
+    switch (field) {
+    case ReportField::GcodeState:
+        return ReadString(reader, &report->gcode_state);
+    case ReportField::GcodeFile:
+        return ReadString(reader, &report->gcode_file);
+    case ReportField::SubtaskName:
+        return ReadString(reader, &report->subtask_name);
+    case ReportField::Percent:
+        return ReadInt(reader, &report->percent);
+    case ReportField::RemainingTime:
+        return ReadInt(reader, &report->remaining_minutes);
+    case ReportField::Layer:
+        return ReadInt(reader, &report->layer);
+    case ReportField::TotalLayers:
+        return ReadInt(reader, &report->total_layers);
+    case ReportField::PrintError:
+        return ReadInt(reader, &report->print_error);
+    case ReportField::NozzleTemp:
+        return ReadNumber(reader, &report->nozzle_temp);
+    case ReportField::NozzleTarget:
+        return ReadNumber(reader, &report->nozzle_target);
+    case ReportField::BedTemp:
+        return ReadNumber(reader, &report->bed_temp);
+    case ReportField::BedTarget:
+        return ReadNumber(reader, &report->bed_target);
+    case ReportField::ChamberTemp:
+        return ReadNumber(reader, &report->chamber_temp);
+    case ReportField::Ams:
+        return ReadAms(reader, report);
+    case ReportField::Hms:
+        return ReadHms(reader, report);
+    default:
+        return reader->SkipValue();
+    }
+}
+
+// Command fields may appear in any top-level section ("print", "system",
+// "pushing", ...) and are only taken from a section that names a command.
+bool ReadSection(JsonReader *reader, bool is_print, PrinterReport *report) {
+    reader->BeginObject();
+    std::optional<std::string> command;
+    std::optional<std::string> sequence_id;
+    std::optional<std::string> result;
+    std::optional<std::string> reason;
+    bool first = true;
+    std::string_view key;
+    while (reader->NextMember(&first, &key)) {
+        bool ok = true;
+        const ReportField field = LookupReportField(key);
+        switch (field) {
+        case ReportField::Command:
+            ok = ReadString(reader, &command);
+            break;
+        case ReportField::SequenceId:
+            ok = ReadString(reader, &sequence_id);
+            break;
+        case ReportField::Result:
+            ok = ReadString(reader, &result);
+            break;
+        case ReportField::Reason:
+            ok = ReadString(reader, &reason);
+            break;
+        default:
+            ok = is_print ? ReadPrintField(reader, field, report) : reader->SkipValue();
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (reader->Failed()) {
+        return false;
+    }
+    if (command) {
+        report->command = std::move(command);
+        report->sequence_id = std::move(sequence_id);
+        report->result = std::move(result);
+        report->reason = std::move(reason);
+    }
+    return true;
+}
+}  // namespace
+
+bool ParsePrinterReport(std::string_view payload, PrinterReport *report) {
+    if (payload.size() < kIndexedParseThreshold) {
+        return ParsePrinterReport(payload, nullptr, report);
+    }
+    thread_local JsonStructuralIndex index;
+    if (!index.Build(payload)) {
+        if (report) {
+            *report = PrinterReport{};
+        }
+        return false;
+    }
+    return ParsePrinterReport(payload, &index, report);
+}
+
+bool ParsePrinterReport(std::string_view payload,
+                        const JsonStructuralIndex *index,
+                        PrinterReport *report) {
+    if (!report) {
+        return false;
+    }
+    *report = PrinterReport{};
+    JsonReader reader(payload, index);
+    if (!reader.BeginObject()) {
+        return false;
+    }
+    bool first = true;
+    std::string_view section;
+    while (reader.NextMember(&first, &section)) {
+        const bool ok = reader.Peek() == '{' ? ReadSection(&reader, section == "print", report)
+                                            : reader.SkipValue();
+        if (!ok) {
+            return false;
+        }
+    }
+    return !reader.Failed() && reader.AtEnd();
+}
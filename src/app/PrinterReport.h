@@ -0,0 +1,73 @@
+#pragma once
+
+#include "app/JsonStructuralIndex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct AmsTrayState {
+    int ams_id = 0;
+    int tray_id = 0;
+    std::string material;
+    std::string color;
+    int remain_percent = -1;
+
+    bool operator==(const AmsTrayState &other) const {
+        return ams_id == other.ams_id && tray_id == other.tray_id &&
+               material == other.material && color == other.color &&
+               remain_percent == other.remain_percent;
+    }
+    bool operator!=(const AmsTrayState &other) const { return !(*this == other); }
+};
+
+struct HmsCode {
+    uint32_t attr = 0;
+    uint32_t code = 0;
+
+    bool operator==(const HmsCode &other) const {
+        return attr == other.attr && code == other.code;
+    }
+    bool operator!=(const HmsCode &other) const { return !(*this == other); }
+};
+
+// One decoded `device/<serial>/report` message. Printers send partial deltas, so
+// every field is optional and only set when present in the payload.
+struct PrinterReport {
+    std::optional<std::string> command;
+    std::optional<std::string> sequence_id;
+    std::optional<std::string> result;
+    std::optional<std::string> reason;
+
+    std::optional<std::string> gcode_state;
+    std::optional<std::string> gcode_file;
+    std::optional<std::string> subtask_name;
+    std::optional<int> percent;
+    std::optional<int> remaining_minutes;
+    std::optional<int> layer;
+    std::optional<int> total_layers;
+    std::optional<int> print_error;
+    std::optional<double> nozzle_temp;
+    std::optional<double> nozzle_target;
+    std::optional<double> bed_temp;
+    std::optional<double> bed_target;
+    std::optional<double> chamber_temp;
+    std::optional<std::vector<AmsTrayState>> ams_trays;
+    std::optional<int> ams_tray_now;
+    std::optional<std::vector<HmsCode>> hms;
+};
+
+// Payloads of at least this many bytes (full pushall reports) are indexed with
+// JsonStructuralIndex first; smaller incremental ones are tokenized directly.
+constexpr size_t kIndexedParseThreshold = 8192;
+
+bool ParsePrinterReport(std::string_view payload, PrinterReport *report);
+
+// Parses with an index the caller already built over |payload|, or without one
+// when |index| is null.
+bool ParsePrinterReport(std::string_view payload,
+                        const JsonStructuralIndex *index,
+                        PrinterReport *report);
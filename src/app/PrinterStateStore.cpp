@@ -0,0 +1,156 @@
+#include "app/PrinterStateStore.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double kTemperatureEpsilon = 0.05;
+
+template <typename T>
+bool MergeValue(const std::optional<T> &incoming, T *current) {
+    if (!incoming || *incoming == *current) {
+        return false;
+    }
+    *current = *incoming;
+    return true;
+}
+
+bool MergeTemperature(const std::optional<double> &incoming, double *current) {
+    if (!incoming || std::fabs(*incoming - *current) < kTemperatureEpsilon) {
+        return false;
+    }
+    *current = *incoming;
+    return true;
+}
+
+// AMS deltas only list the units that changed, so trays are replaced per unit
+// rather than wholesale.
+bool MergeAmsTrays(const std::vector<AmsTrayState> &incoming, std::vector<AmsTrayState> *current) {
+    std::vector<AmsTrayState> merged;
+    merged.reserve(current->size() + incoming.size());
+    for (const auto &tray : *current) {
+        const bool replaced =
+            std::any_of(incoming.begin(), incoming.end(), [&tray](const AmsTrayState &update) {
+                return update.ams_id == tray.ams_id;
+            });
+        if (!replaced) {
+            merged.push_back(tray);
+        }
+    }
+    merged.insert(merged.end(), incoming.begin(), incoming.end());
+    std::sort(merged.begin(), merged.end(), [](const AmsTrayState &lhs, const AmsTrayState &rhs) {
+        return lhs.ams_id != rhs.ams_id ? lhs.ams_id < rhs.ams_id : lhs.tray_id < rhs.tray_id;
+    });
+    if (merged == *current) {
+        return false;
+    }
+    *current = std::move(merged);
+    return true;
+}
+}  // namespace
+
+size_t PrinterStateStore::Subscribe(PrinterFieldMask fields, Listener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Subscription subscription;
+    subscription.token = next_token_++;
+    subscription.fields = fields;
+    subscription.listener = std::move(listener);
+    subscriptions_.push_back(std::move(subscription));
+    return subscriptions_.back().token;
+}
+
+void PrinterStateStore::Unsubscribe(size_t token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscriptions_.erase(std::remove_if(subscriptions_.begin(),
+                                        subscriptions_.end(),
+                                        [token](const Subscription &subscription) {
+                                            return subscription.token == token;
+                                        }),
+                         subscriptions_.end());
+}
+
+PrinterFieldMask PrinterStateStore::Apply(const wxString &printer_key,
+                                          const PrinterReport &report) {
+    PrinterFieldMask changed = 0;
+    PrinterState snapshot;
+    std::vector<Listener> listeners;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PrinterState &state = states_[printer_key];
+        if (MergeValue(report.gcode_state, &state.gcode_state)) {
+            changed = changed | PrinterField::GcodeState;
+        }
+        if (MergeValue(report.gcode_file, &state.gcode_file)) {
+            changed = changed | PrinterField::GcodeFile;
+        }
+        if (MergeValue(report.subtask_name, &state.subtask_name)) {
+            changed = changed | PrinterField::SubtaskName;
+        }
+        if (MergeValue(report.percent, &state.percent)) {
+            changed = changed | PrinterField::Progress;
+        }
+        if (MergeValue(report.remaining_minutes, &state.remaining_minutes)) {
+            changed = changed | PrinterField::RemainingTime;
+        }
+        const bool layer_changed = MergeValue(report.layer, &state.layer);
+        if (MergeValue(report.total_layers, &state.total_layers) || layer_changed) {
+            changed = changed | PrinterField::Layers;
+        }
+        if (MergeValue(report.print_error, &state.print_error)) {
+            changed = changed | PrinterField::PrintError;
+        }
+        bool temperatures_changed = MergeTemperature(report.nozzle_temp, &state.nozzle_temp);
+        temperatures_changed |= MergeTemperature(report.nozzle_target, &state.nozzle_target);
+        temperatures_changed |= MergeTemperature(report.bed_temp, &state.bed_temp);
+        temperatures_changed |= MergeTemperature(report.bed_target, &state.bed_target);
+        temperatures_changed |= MergeTemperature(report.chamber_temp, &state.chamber_temp);
+        if (temperatures_changed) {
+            changed = changed | PrinterField::Temperatures;
+        }
+        bool ams_changed = MergeValue(report.ams_tray_now, &state.ams_tray_now);
+        if (report.ams_trays) {
+            ams_changed |= MergeAmsTrays(*report.ams_trays, &state.ams_trays);
+        }
+        if (ams_changed) {
+            changed = changed | PrinterField::Ams;
+        }
+        if (MergeValue(report.hms, &state.hms)) {
+            changed = changed | PrinterField::Hms;
+        }
+        if (changed == 0) {
+            return 0;
+        }
+
+        state.revision += 1;
+        for (const auto &subscription : subscriptions_) {
+            if ((subscription.fields & changed) != 0) {
+                listeners.push_back(subscription.listener);
+            }
+        }
+        if (!listeners.empty()) {
+            snapshot = state;
+        }
+    }
+
+    for (const auto &listener : listeners) {
+        listener(printer_key, snapshot, changed);
+    }
+    return changed;
+}
+
+bool PrinterStateStore::GetState(const wxString &printer_key, PrinterState *state) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = states_.find(printer_key);
+    if (it == states_.end()) {
+        return false;
+    }
+    if (state) {
+        *state = it->second;
+    }
+    return true;
+}
+
+void PrinterStateStore::Remove(const wxString &printer_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    states_.erase(printer_key);
+}
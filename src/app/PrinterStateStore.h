@@ -0,0 +1,90 @@
+#pragma once
+
+#include "app/PrinterReport.h"
+
+#include <wx/string.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class PrinterField : uint32_t {
+    GcodeState = 1u << 0,
+    GcodeFile = 1u << 1,
+    SubtaskName = 1u << 2,
+    Progress = 1u << 3,
+    RemainingTime = 1u << 4,
+    Layers = 1u << 5,
+    Temperatures = 1u << 6,
+    Ams = 1u << 7,
+    Hms = 1u << 8,
+    PrintError = 1u << 9,
+};
+
+using PrinterFieldMask = uint32_t;
+
+constexpr PrinterFieldMask kAllPrinterFields = (1u << 10) - 1;
+
+constexpr PrinterFieldMask operator|(PrinterField lhs, PrinterField rhs) {
+    return static_cast<PrinterFieldMask>(lhs) | static_cast<PrinterFieldMask>(rhs);
+}
+
+constexpr PrinterFieldMask operator|(PrinterFieldMask lhs, PrinterField rhs) {
+    return lhs | static_cast<PrinterFieldMask>(rhs);
+}
+
+constexpr bool HasField(PrinterFieldMask mask, PrinterField field) {
+    return (mask & static_cast<PrinterFieldMask>(field)) != 0;
+}
+
+struct PrinterState {
+    std::string gcode_state;
+    std::string gcode_file;
+    std::string subtask_name;
+    int percent = -1;
+    int remaining_minutes = -1;
+    int layer = -1;
+    int total_layers = -1;
+    int print_error = 0;
+    double nozzle_temp = 0.0;
+    double nozzle_target = 0.0;
+    double bed_temp = 0.0;
+    double bed_target = 0.0;
+    double chamber_temp = 0.0;
+    std::vector<AmsTrayState> ams_trays;
+    int ams_tray_now = -1;
+    std::vector<HmsCode> hms;
+    uint64_t revision = 0;
+};
+
+class PrinterStateStore {
+public:
+    using Listener = std::function<void(const wxString &printer_key,
+                                        const PrinterState &state,
+                                        PrinterFieldMask changed)>;
+
+    size_t Subscribe(PrinterFieldMask fields, Listener listener);
+    void Unsubscribe(size_t token);
+
+    // Merges a report delta into the printer's state and notifies subscribers whose
+    // fields changed. Returns the mask of fields that changed.
+    PrinterFieldMask Apply(const wxString &printer_key, const PrinterReport &report);
+    bool GetState(const wxString &printer_key, PrinterState *state) const;
+    void Remove(const wxString &printer_key);
+
+private:
+    struct Subscription {
+        size_t token = 0;
+        PrinterFieldMask fields = 0;
+        Listener listener;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<wxString, PrinterState> states_;
+    std::vector<Subscription> subscriptions_;
+    size_t next_token_ = 1;
+};
@@ -0,0 +1,163 @@
+#include "app/PrinterTimeline.h"
+
+#include "app/ReportFields.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr PrinterFieldMask kTimelineFields = PrinterField::GcodeState | PrinterField::GcodeFile |
+                                             PrinterField::Progress | PrinterField::RemainingTime;
+// Time constant of the moving average. Reports arrive about once a second while
+// printing but the firmware only re-estimates once a minute, so a jump in its
+// estimate is mostly absorbed within a few minutes whatever the report rate.
+constexpr auto kSmoothingTime = std::chrono::minutes(3);
+// Below this much progress a rate extrapolation is mostly warm-up time.
+constexpr int kMinExtrapolationPercent = 5;
+
+bool IsBusyState(GcodeState state) {
+    switch (state) {
+    case GcodeState::Init:
+    case GcodeState::Slicing:
+    case GcodeState::Prepare:
+    case GcodeState::Running:
+    case GcodeState::Pause:
+        return true;
+    default:
+        return false;
+    }
+}
+}  // namespace
+
+PrinterTimeline::PrinterTimeline(PrinterStateStore &store) : store_(store) {}
+
+PrinterTimeline::~PrinterTimeline() {
+    Stop();
+}
+
+void PrinterTimeline::Start() {
+    if (subscription_ != 0) {
+        return;
+    }
+    subscription_ = store_.Subscribe(kTimelineFields,
+                                     [this](const wxString &printer_key,
+                                            const PrinterState &state,
+                                            PrinterFieldMask changed) {
+                                         wxUnusedVar(changed);
+                                         Observe(printer_key, state, Clock::now());
+                                     });
+}
+
+void PrinterTimeline::Stop() {
+    if (subscription_ != 0) {
+        store_.Unsubscribe(subscription_);
+        subscription_ = 0;
+    }
+}
+
+void PrinterTimeline::Observe(const wxString &printer_key,
+                              const PrinterState &state,
+                              Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Track &track = tracks_[printer_key];
+    const bool busy = IsBusyState(LookupGcodeState(state.gcode_state));
+    if (!busy) {
+        track = Track();
+        track.free_at = now;
+        track.percent = state.percent;
+        track.gcode_file = state.gcode_file;
+        return;
+    }
+
+    if (!track.busy || track.gcode_file != state.gcode_file) {
+        track = Track();
+        track.busy = true;
+        track.gcode_file = state.gcode_file;
+        track.first_seen = now;
+        track.first_percent = state.percent;
+    }
+    track.percent = state.percent;
+
+    Clock::time_point reading;
+    // Firmware reports 0 minutes left while still preparing; that is no estimate.
+    if (state.remaining_minutes > 0 || (state.remaining_minutes == 0 && state.percent >= 99)) {
+        reading = now + std::chrono::minutes(state.remaining_minutes);
+    } else if (state.percent >= kMinExtrapolationPercent && state.percent < 100 &&
+               track.first_percent >= 0 && state.percent > track.first_percent) {
+        const auto elapsed = now - track.first_seen;
+        const double rate = static_cast<double>(state.percent - track.first_percent);
+        reading = now + std::chrono::duration_cast<Clock::duration>(
+                            elapsed * (static_cast<double>(100 - state.percent) / rate));
+    } else {
+        return;
+    }
+
+    if (!track.estimated) {
+        track.free_at = reading;
+        track.last_reading = now;
+        track.estimated = true;
+        return;
+    }
+    const double elapsed = std::chrono::duration<double>(now - track.last_reading).count();
+    const double weight =
+        1.0 - std::exp(-elapsed / std::chrono::duration<double>(kSmoothingTime).count());
+    track.last_reading = now;
+    track.free_at +=
+        std::chrono::duration_cast<Clock::duration>((reading - track.free_at) * weight);
+}
+
+bool PrinterTimeline::GetForecast(const wxString &printer_key, PrinterForecast *forecast) const {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tracks_.find(printer_key);
+    if (it == tracks_.end()) {
+        return false;
+    }
+    *forecast = MakeForecast(printer_key, it->second, now);
+    return true;
+}
+
+std::vector<PrinterForecast> PrinterTimeline::GetTimeline() const {
+    const Clock::time_point now = Clock::now();
+    std::vector<PrinterForecast> timeline;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timeline.reserve(tracks_.size());
+        for (const auto &entry : tracks_) {
+            timeline.push_back(MakeForecast(entry.first, entry.second, now));
+        }
+    }
+    std::stable_sort(timeline.begin(),
+                     timeline.end(),
+                     [](const PrinterForecast &lhs, const PrinterForecast &rhs) {
+                         return lhs.free_at < rhs.free_at;
+                     });
+    return timeline;
+}
+
+int64_t PrinterTimeline::GetSecondsUntilFree(const wxString &printer_key) const {
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tracks_.find(printer_key);
+    if (it == tracks_.end() || (it->second.busy && !it->second.estimated)) {
+        return -1;
+    }
+    if (!it->second.busy || it->second.free_at <= now) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::seconds>(it->second.free_at - now).count();
+}
+
+PrinterForecast PrinterTimeline::MakeForecast(const wxString &printer_key,
+                                              const Track &track,
+                                              Clock::time_point now) {
+    PrinterForecast forecast;
+    forecast.printer_key = printer_key;
+    forecast.busy = track.busy;
+    forecast.free_at = track.busy && track.estimated ? std::max(track.free_at, now) : now;
+    forecast.seconds_until_free =
+        std::chrono::duration_cast<std::chrono::seconds>(forecast.free_at - now).count();
+    forecast.percent = track.percent;
+    forecast.gcode_file = track.gcode_file;
+    return forecast;
+}
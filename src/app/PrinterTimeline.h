@@ -0,0 +1,76 @@
+#pragma once
+
+#include "app/PrinterStateStore.h"
+
+#include <wx/string.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct PrinterForecast {
+    wxString printer_key;
+    bool busy = false;
+    // When the current print should end. For a printer that is not busy, the time
+    // the forecast was read. Steady clock, so a wall-clock step cannot move it.
+    std::chrono::steady_clock::time_point free_at;
+    int64_t seconds_until_free = 0;
+    int percent = -1;
+    std::string gcode_file;
+};
+
+// When each printer will next be free, kept current from the state store so the
+// scheduler, upload-ahead and the UI all read one forecast instead of each
+// reworking it from raw reports. The printer's own remaining-minutes figure is
+// whole minutes and jumps around as the firmware re-estimates, so successive
+// readings of the same print are blended with an exponential moving average
+// weighted by the time between them, so the result does not depend on how often
+// the printer reports.
+// When a report has no remaining time, the forecast extrapolates from progress
+// since the print was first seen. Thread-safe.
+class PrinterTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PrinterTimeline(PrinterStateStore &store);
+    ~PrinterTimeline();
+
+    PrinterTimeline(const PrinterTimeline &) = delete;
+    PrinterTimeline &operator=(const PrinterTimeline &) = delete;
+
+    void Start();
+    void Stop();
+    void Observe(const wxString &printer_key, const PrinterState &state, Clock::time_point now);
+
+    bool GetForecast(const wxString &printer_key, PrinterForecast *forecast) const;
+    // Every printer seen so far, soonest free first.
+    std::vector<PrinterForecast> GetTimeline() const;
+    // 0 when the printer is not busy; -1 when it is busy with no usable estimate
+    // yet, or has never reported.
+    int64_t GetSecondsUntilFree(const wxString &printer_key) const;
+
+private:
+    struct Track {
+        bool busy = false;
+        bool estimated = false;
+        std::string gcode_file;
+        int percent = -1;
+        Clock::time_point first_seen;
+        int first_percent = -1;
+        Clock::time_point free_at;
+        Clock::time_point last_reading;
+    };
+
+    static PrinterForecast MakeForecast(const wxString &printer_key,
+                                        const Track &track,
+                                        Clock::time_point now);
+
+    PrinterStateStore &store_;
+    size_t subscription_ = 0;
+    mutable std::mutex mutex_;
+    std::map<wxString, Track> tracks_;
+};
@@ -0,0 +1,105 @@
+#include "app/RemoteFileCache.h"
+
+bool RemoteFileCache::IsLoaded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_;
+}
+
+void RemoteFileCache::Load(const std::vector<RemoteFile> &files) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<wxString, Entry> entries;
+    uint64_t uploaded_bytes = 0;
+    for (const RemoteFile &file : files) {
+        auto [it, inserted] = entries.try_emplace(file.name);
+        if (!inserted) {
+            continue;
+        }
+        Entry &entry = it->second;
+        entry.size = file.size;
+        auto previous = entries_.find(file.name);
+        if (previous != entries_.end() && previous->second.uploaded_by_app) {
+            entry.uploaded_by_app = true;
+            entry.recency = previous->second.recency;
+            uploaded_bytes += file.size;
+            entries_.erase(previous);
+        }
+    }
+    // Whatever is left was deleted behind our back.
+    for (const auto &stale : entries_) {
+        if (stale.second.uploaded_by_app) {
+            recency_.erase(stale.second.recency);
+        }
+    }
+    entries_ = std::move(entries);
+    uploaded_bytes_ = uploaded_bytes;
+    loaded_ = true;
+}
+
+bool RemoteFileCache::Lookup(const wxString &name, uint64_t *size) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(name);
+    if (it == entries_.end()) {
+        return false;
+    }
+    *size = it->second.size;
+    return true;
+}
+
+void RemoteFileCache::Refresh(const wxString &name, bool exists, uint64_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!exists) {
+        EraseLocked(name);
+        return;
+    }
+    Entry &entry = entries_[name];
+    if (entry.uploaded_by_app) {
+        uploaded_bytes_ = uploaded_bytes_ - entry.size + size;
+        Touch(&entry);
+    }
+    entry.size = size;
+}
+
+void RemoteFileCache::RecordUpload(const wxString &name, uint64_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry &entry = entries_[name];
+    if (entry.uploaded_by_app) {
+        uploaded_bytes_ -= entry.size;
+        Touch(&entry);
+    } else {
+        entry.uploaded_by_app = true;
+        entry.recency = recency_.insert(recency_.begin(), name);
+    }
+    entry.size = size;
+    uploaded_bytes_ += size;
+}
+
+void RemoteFileCache::Remove(const wxString &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EraseLocked(name);
+}
+
+std::vector<wxString> RemoteFileCache::TakeEvictions(uint64_t budget_bytes, size_t keep_recent) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<wxString> evicted;
+    while (uploaded_bytes_ > budget_bytes && recency_.size() > keep_recent) {
+        evicted.push_back(recency_.back());
+        EraseLocked(evicted.back());
+    }
+    return evicted;
+}
+
+void RemoteFileCache::Touch(Entry *entry) {
+    recency_.splice(recency_.begin(), recency_, entry->recency);
+}
+
+void RemoteFileCache::EraseLocked(const wxString &name) {
+    auto it = entries_.find(name);
+    if (it == entries_.end()) {
+        return;
+    }
+    if (it->second.uploaded_by_app) {
+        uploaded_bytes_ -= it->second.size;
+        recency_.erase(it->second.recency);
+    }
+    entries_.erase(it);
+}
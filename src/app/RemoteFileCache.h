@@ -0,0 +1,59 @@
+#pragma once
+
+#include "app/FtpsClient.h"
+
+#include <wx/string.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// What one printer's storage holds, so a dispatch can skip uploading a file that
+// is already there. The index starts from a LIST and is then kept current one
+// file at a time: a SIZE before each reuse, an entry after each upload and a
+// removal after each delete. Files this app uploaded are also kept in least
+// recently used order so the oldest can be evicted once they outgrow a budget;
+// anything else on the printer is never touched. Safe to use from several
+// upload workers.
+class RemoteFileCache {
+public:
+    RemoteFileCache() = default;
+
+    RemoteFileCache(const RemoteFileCache &) = delete;
+    RemoteFileCache &operator=(const RemoteFileCache &) = delete;
+
+    bool IsLoaded() const;
+    // Replaces the index with a fresh listing. Files uploaded earlier in this run
+    // keep their place in the eviction order if they are still present.
+    void Load(const std::vector<RemoteFile> &files);
+    // Returns false, leaving |size| alone, if the index has no such file.
+    bool Lookup(const wxString &name, uint64_t *size) const;
+    // Records the result of a SIZE; a reused app file also becomes most recent.
+    void Refresh(const wxString &name, bool exists, uint64_t size);
+    void RecordUpload(const wxString &name, uint64_t size);
+    void Remove(const wxString &name);
+    // Drops app-uploaded files, oldest first, from the index until they fit in
+    // |budget_bytes| and returns their names for the caller to delete. The
+    // |keep_recent| most recently used files are never chosen, however large.
+    std::vector<wxString> TakeEvictions(uint64_t budget_bytes, size_t keep_recent);
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        bool uploaded_by_app = false;
+        std::list<wxString>::iterator recency;
+    };
+
+    void Touch(Entry *entry);
+    void EraseLocked(const wxString &name);
+
+    mutable std::mutex mutex_;
+    bool loaded_ = false;
+    std::map<wxString, Entry> entries_;
+    // App-uploaded names, most recently used first.
+    std::list<wxString> recency_;
+    uint64_t uploaded_bytes_ = 0;
+};
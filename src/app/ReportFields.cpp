@@ -0,0 +1,165 @@
+#include "app/ReportFields.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+constexpr unsigned kSlotBits = 6;
+constexpr size_t kSlotCount = size_t{1} << kSlotBits;
+constexpr uint8_t kEmptySlot = 0xFF;
+constexpr int kMaxSeedAttempts = 100000;
+
+template <typename Value>
+struct NamedValue {
+    std::string_view name;
+    Value value;
+};
+
+template <typename Value, size_t N>
+struct PerfectHashTable {
+    std::array<NamedValue<Value>, N> entries;
+    bool fold_case = false;
+    uint32_t seed = 0;
+    std::array<uint8_t, kSlotCount> slots{};
+};
+
+constexpr uint8_t FoldCase(uint8_t ch) {
+    return ch >= 'A' && ch <= 'Z' ? static_cast<uint8_t>(ch - 'A' + 'a') : ch;
+}
+
+// Length and the first, middle and last bytes tell every name in a table apart;
+// BuildTable fails to find a seed if a new entry breaks that.
+constexpr uint32_t NameFeatures(std::string_view name, bool fold_case) {
+    if (name.empty()) {
+        return 0;
+    }
+    auto byte = [name, fold_case](size_t index) -> uint32_t {
+        const auto ch = static_cast<uint8_t>(name[index]);
+        return fold_case ? FoldCase(ch) : ch;
+    };
+    return static_cast<uint32_t>(name.size()) ^ (byte(0) << 8) ^ (byte(name.size() / 2) << 16) ^
+           (byte(name.size() - 1) << 24);
+}
+
+constexpr size_t SlotOf(uint32_t features, uint32_t seed) {
+    return static_cast<size_t>((features * seed) >> (32 - kSlotBits));
+}
+
+template <typename Value, size_t N>
+constexpr PerfectHashTable<Value, N> BuildTable(const std::array<NamedValue<Value>, N> &entries,
+                                                bool fold_case) {
+    static_assert(N < kSlotCount, "perfect hash table is full");
+    PerfectHashTable<Value, N> table{entries, fold_case, 0, {}};
+    uint32_t seed = 0x9E3779B1u;
+    for (int attempt = 0; attempt < kMaxSeedAttempts; ++attempt, seed += 2) {
+        std::array<uint8_t, kSlotCount> slots{};
+        for (auto &slot : slots) {
+            slot = kEmptySlot;
+        }
+        bool collision = false;
+        for (size_t index = 0; index < N && !collision; ++index) {
+            const size_t slot = SlotOf(NameFeatures(entries[index].name, fold_case), seed);
+            collision = slots[slot] != kEmptySlot;
+            slots[slot] = static_cast<uint8_t>(index);
+        }
+        if (!collision) {
+            table.seed = seed;
+            table.slots = slots;
+            return table;
+        }
+    }
+    return table;
+}
+
+template <typename Value, size_t N>
+constexpr Value Lookup(const PerfectHashTable<Value, N> &table,
+                       std::string_view name,
+                       Value missing) {
+    const uint8_t index = table.slots[SlotOf(NameFeatures(name, table.fold_case), table.seed)];
+    if (index == kEmptySlot) {
+        return missing;
+    }
+    const NamedValue<Value> &entry = table.entries[index];
+    if (entry.name.size() != name.size()) {
+        return missing;
+    }
+    if (!table.fold_case) {
+        return entry.name == name ? entry.value : missing;
+    }
+    for (size_t offset = 0; offset < name.size(); ++offset) {
+        if (FoldCase(static_cast<uint8_t>(name[offset])) !=
+            static_cast<uint8_t>(entry.name[offset])) {
+            return missing;
+        }
+    }
+    return entry.value;
+}
+
+constexpr std::array<NamedValue<ReportField>, 27> kReportFieldNames = {{
+    {"command", ReportField::Command},
+    {"sequence_id", ReportField::SequenceId},
+    {"result", ReportField::Result},
+    {"reason", ReportField::Reason},
+    {"gcode_state", ReportField::GcodeState},
+    {"gcode_file", ReportField::GcodeFile},
+    {"subtask_name", ReportField::SubtaskName},
+    {"mc_percent", ReportField::Percent},
+    {"mc_remaining_time", ReportField::RemainingTime},
+    {"layer_num", ReportField::Layer},
+    {"total_layer_num", ReportField::TotalLayers},
+    {"print_error", ReportField::PrintError},
+    {"nozzle_temper", ReportField::NozzleTemp},
+    {"nozzle_target_temper", ReportField::NozzleTarget},
+    {"bed_temper", ReportField::BedTemp},
+    {"bed_target_temper", ReportField::BedTarget},
+    {"chamber_temper", ReportField::ChamberTemp},
+    {"ams", ReportField::Ams},
+    {"hms", ReportField::Hms},
+    {"tray_now", ReportField::TrayNow},
+    {"id", ReportField::Id},
+    {"tray", ReportField::Tray},
+    {"tray_type", ReportField::TrayType},
+    {"tray_color", ReportField::TrayColor},
+    {"remain", ReportField::Remain},
+    {"attr", ReportField::Attr},
+    {"code", ReportField::Code},
+}};
+
+// Names are stored lowercase; lookups fold the input.
+constexpr std::array<NamedValue<GcodeState>, 13> kGcodeStateNames = {{
+    {"idle", GcodeState::Idle},
+    {"init", GcodeState::Init},
+    {"slicing", GcodeState::Slicing},
+    {"prepare", GcodeState::Prepare},
+    {"running", GcodeState::Running},
+    {"pause", GcodeState::Pause},
+    {"finish", GcodeState::Finish},
+    {"failed", GcodeState::Failed},
+    {"offline", GcodeState::Offline},
+    {"printing", GcodeState::Running},
+    {"busy", GcodeState::Running},
+    {"complete", GcodeState::Finish},
+    {"completed", GcodeState::Finish},
+}};
+
+constexpr auto kReportFieldTable = BuildTable(kReportFieldNames, false);
+constexpr auto kGcodeStateTable = BuildTable(kGcodeStateNames, true);
+static_assert(kReportFieldTable.seed != 0, "report field names need a wider hash");
+static_assert(kGcodeStateTable.seed != 0, "gcode_state names need a wider hash");
+static_assert(Lookup(kReportFieldTable, "nozzle_target_temper", ReportField::Unknown) ==
+              ReportField::NozzleTarget);
+static_assert(Lookup(kGcodeStateTable, "RUNNING", GcodeState::Unknown) == GcodeState::Running);
+}  // namespace
+
+ReportField LookupReportField(std::string_view key) {
+    return Lookup(kReportFieldTable, key, ReportField::Unknown);
+}
+
+GcodeState LookupGcodeState(std::string_view state) {
+    return Lookup(kGcodeStateTable, state, GcodeState::Unknown);
+}
+
+bool IsPrintingState(GcodeState state) {
+    return state == GcodeState::Running;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string_view>
+
+// Every report key the parser acts on. Keys are looked up once per member and
+// dispatched by section, so the same key ("id") may mean different things in
+// an AMS unit and in a tray.
+enum class ReportField {
+    Unknown,
+    Command,
+    SequenceId,
+    Result,
+    Reason,
+    GcodeState,
+    GcodeFile,
+    SubtaskName,
+    Percent,
+    RemainingTime,
+    Layer,
+    TotalLayers,
+    PrintError,
+    NozzleTemp,
+    NozzleTarget,
+    BedTemp,
+    BedTarget,
+    ChamberTemp,
+    Ams,
+    Hms,
+    TrayNow,
+    Id,
+    Tray,
+    TrayType,
+    TrayColor,
+    Remain,
+    Attr,
+    Code,
+};
+
+enum class GcodeState {
+    Unknown,
+    Idle,
+    Init,
+    Slicing,
+    Prepare,
+    Running,
+    Pause,
+    Finish,
+    Failed,
+    Offline,
+};
+
+// Both lookups go through a perfect hash built at compile time: one multiply
+// picks the only candidate entry, and a length check plus compare confirms it.
+ReportField LookupReportField(std::string_view key);
+// Case-insensitive. Older firmware and bridges spell some states differently
+// ("PRINTING", "BUSY", "COMPLETED"); those map onto Running and Finish.
+GcodeState LookupGcodeState(std::string_view state);
+
+bool IsPrintingState(GcodeState state);
@@ -0,0 +1,192 @@
+#include "app/ReportRecording.h"
+
+#include <wx/log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+constexpr char kRecordingMagic[8] = {'B', 'Q', 'R', 'E', 'C', '0', '0', '1'};
+constexpr size_t kRecordHeaderSize = 16;
+constexpr uint32_t kMaxKeyLength = 1024;
+constexpr uint32_t kMaxPayloadLength = 16 * 1024 * 1024;
+constexpr auto kMaxReplaySleep = std::chrono::milliseconds(100);
+
+void PutLittleEndian(uint64_t value, size_t bytes, unsigned char *out) {
+    for (size_t index = 0; index < bytes; ++index) {
+        out[index] = static_cast<unsigned char>(value >> (8 * index));
+    }
+}
+
+uint64_t GetLittleEndian(const unsigned char *in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t index = 0; index < bytes; ++index) {
+        value |= static_cast<uint64_t>(in[index]) << (8 * index);
+    }
+    return value;
+}
+}  // namespace
+
+ReportRecorder::~ReportRecorder() {
+    Close();
+}
+
+bool ReportRecorder::Open(const wxString &path, wxString *error_message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_.IsOpened()) {
+        file_.Close();
+    }
+    if (!file_.Open(path, "wb")) {
+        if (error_message) {
+            *error_message = wxString::Format("Unable to create report recording %s.", path);
+        }
+        return false;
+    }
+    if (file_.Write(kRecordingMagic, sizeof(kRecordingMagic)) != sizeof(kRecordingMagic)) {
+        file_.Close();
+        if (error_message) {
+            *error_message = wxString::Format("Unable to write report recording %s.", path);
+        }
+        return false;
+    }
+    origin_ = std::chrono::steady_clock::now();
+    records_ = 0;
+    failed_ = false;
+    return true;
+}
+
+void ReportRecorder::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_.IsOpened()) {
+        file_.Close();
+    }
+}
+
+bool ReportRecorder::IsOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.IsOpened() && !failed_;
+}
+
+void ReportRecorder::Record(std::string_view printer_key, std::string_view payload) {
+    const auto now = std::chrono::steady_clock::now();
+    if (printer_key.size() > kMaxKeyLength || payload.size() > kMaxPayloadLength) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.IsOpened() || failed_) {
+        return;
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - origin_);
+    unsigned char header[kRecordHeaderSize];
+    PutLittleEndian(static_cast<uint64_t>(std::max<int64_t>(0, elapsed.count())), 8, header);
+    PutLittleEndian(printer_key.size(), 4, header + 8);
+    PutLittleEndian(payload.size(), 4, header + 12);
+    if (file_.Write(header, sizeof(header)) != sizeof(header) ||
+        file_.Write(printer_key.data(), printer_key.size()) != printer_key.size() ||
+        file_.Write(payload.data(), payload.size()) != payload.size()) {
+        wxLogError("ReportRecorder: write failed, recording stopped after %llu reports.",
+                   static_cast<unsigned long long>(records_));
+        failed_ = true;
+        return;
+    }
+    records_ += 1;
+}
+
+uint64_t ReportRecorder::GetRecordCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+}
+
+bool ReportRecordingReader::Open(const wxString &path, wxString *error_message) {
+    if (!file_.Open(path, "rb")) {
+        if (error_message) {
+            *error_message = wxString::Format("Unable to open report recording %s.", path);
+        }
+        return false;
+    }
+    char magic[sizeof(kRecordingMagic)] = {};
+    if (file_.Read(magic, sizeof(magic)) != sizeof(magic) ||
+        std::memcmp(magic, kRecordingMagic, sizeof(magic)) != 0) {
+        file_.Close();
+        if (error_message) {
+            *error_message = wxString::Format("%s is not a report recording.", path);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool ReportRecordingReader::Next(RecordedReport *report) {
+    if (!file_.IsOpened()) {
+        return false;
+    }
+    unsigned char header[kRecordHeaderSize];
+    if (file_.Read(header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    const uint64_t key_length = GetLittleEndian(header + 8, 4);
+    const uint64_t payload_length = GetLittleEndian(header + 12, 4);
+    if (key_length > kMaxKeyLength || payload_length > kMaxPayloadLength) {
+        wxLogWarning("ReportRecordingReader: corrupt record header, stopping replay.");
+        return false;
+    }
+    report->timestamp_us = GetLittleEndian(header, 8);
+    report->printer_key.resize(key_length);
+    report->payload.resize(payload_length);
+    return file_.Read(report->printer_key.data(), key_length) == key_length &&
+           file_.Read(report->payload.data(), payload_length) == payload_length;
+}
+
+bool ReplayReportRecording(const wxString &path,
+                           double speed,
+                           const std::atomic<bool> &cancelled,
+                           const std::function<void(const RecordedReport &report)> &sink,
+                           ReportReplayStats *stats,
+                           wxString *error_message) {
+    ReportRecordingReader reader;
+    if (!reader.Open(path, error_message)) {
+        return false;
+    }
+
+    ReportReplayStats local_stats;
+    RecordedReport report;
+    uint64_t first_timestamp_us = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (!cancelled.load() && reader.Next(&report)) {
+        if (local_stats.reports == 0) {
+            first_timestamp_us = report.timestamp_us;
+        }
+        const uint64_t offset_us =
+            report.timestamp_us > first_timestamp_us ? report.timestamp_us - first_timestamp_us
+                                                     : 0;
+        if (speed > 0.0) {
+            const std::chrono::duration<double, std::micro> scaled(
+                static_cast<double>(offset_us) / speed);
+            const auto due =
+                start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(scaled);
+            while (!cancelled.load()) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= due) {
+                    break;
+                }
+                std::this_thread::sleep_for(
+                    std::min<std::chrono::steady_clock::duration>(due - now, kMaxReplaySleep));
+            }
+            if (cancelled.load()) {
+                break;
+            }
+        }
+        sink(report);
+        local_stats.reports += 1;
+        local_stats.bytes += report.payload.size();
+        local_stats.recorded_seconds = static_cast<double>(offset_us) / 1e6;
+    }
+    local_stats.elapsed_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats) {
+        *stats = local_stats;
+    }
+    return true;
+}
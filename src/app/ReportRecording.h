@@ -0,0 +1,71 @@
+#pragma once
+
+#include <wx/ffile.h>
+#include <wx/string.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+struct RecordedReport {
+    uint64_t timestamp_us = 0;
+    std::string printer_key;
+    std::string payload;
+};
+
+struct ReportReplayStats {
+    uint64_t reports = 0;
+    uint64_t bytes = 0;
+    double elapsed_seconds = 0.0;
+    double recorded_seconds = 0.0;
+};
+
+// Appends every raw report to a compact binary file: a magic header, then one
+// record per report made of a 16-byte little-endian header (microseconds since
+// the recording started, key length, payload length) followed by the printer
+// key and payload bytes. Safe to call from any MQTT I/O thread.
+class ReportRecorder {
+public:
+    ReportRecorder() = default;
+    ~ReportRecorder();
+
+    ReportRecorder(const ReportRecorder &) = delete;
+    ReportRecorder &operator=(const ReportRecorder &) = delete;
+
+    bool Open(const wxString &path, wxString *error_message);
+    void Close();
+    bool IsOpen() const;
+    void Record(std::string_view printer_key, std::string_view payload);
+    uint64_t GetRecordCount() const;
+
+private:
+    mutable std::mutex mutex_;
+    wxFFile file_;
+    std::chrono::steady_clock::time_point origin_;
+    uint64_t records_ = 0;
+    bool failed_ = false;
+};
+
+class ReportRecordingReader {
+public:
+    bool Open(const wxString &path, wxString *error_message);
+    // Returns false at the end of the recording. A truncated final record, as
+    // left behind by a crash mid-write, is treated as the end.
+    bool Next(RecordedReport *report);
+
+private:
+    wxFFile file_;
+};
+
+// Feeds a recording to |sink| in order. A speed of 1 reproduces the original
+// timing, N plays N times faster and 0 plays as fast as the sink allows.
+bool ReplayReportRecording(const wxString &path,
+                           double speed,
+                           const std::atomic<bool> &cancelled,
+                           const std::function<void(const RecordedReport &report)> &sink,
+                           ReportReplayStats *stats,
+                           wxString *error_message);
@@ -0,0 +1,211 @@
+#include "app/StringUtil.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr uint64_t kOnes = 0x0101010101010101ULL;
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+// The SWAR byte tests below only say whether some byte in the word matches;
+// the per-byte bits are not exact, so a dirty word is rescanned byte by byte.
+constexpr uint64_t HasByteBelow(uint64_t word, uint8_t limit) {
+    return (word - kOnes * limit) & ~word & kHighBits;
+}
+
+constexpr uint64_t HasByte(uint64_t word, uint8_t value) {
+    return HasByteBelow(word ^ (kOnes * value), 1);
+}
+
+bool NeedsEscape(uint64_t word) {
+    return (HasByteBelow(word, 0x20) | HasByte(word, '"') | HasByte(word, '\\')) != 0;
+}
+
+bool NeedsEscape(unsigned char ch) {
+    return ch < 0x20 || ch == '"' || ch == '\\';
+}
+
+void AppendEscape(unsigned char ch, std::string *out) {
+    switch (ch) {
+    case '"':
+        out->append("\\\"");
+        break;
+    case '\\':
+        out->append("\\\\");
+        break;
+    case '\n':
+        out->append("\\n");
+        break;
+    case '\r':
+        out->append("\\r");
+        break;
+    case '\t':
+        out->append("\\t");
+        break;
+    default: {
+        const char escape[] = {'\\', 'u', '0', '0', kHexDigits[ch >> 4], kHexDigits[ch & 0xF]};
+        out->append(escape, sizeof(escape));
+        break;
+    }
+    }
+}
+
+uint32_t FoldCase(uint32_t ch) {
+    return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch;
+}
+}  // namespace
+
+std::string ToUtf8(const wxString &value) {
+    const wxScopedCharBuffer utf8 = value.utf8_str();
+    return std::string(utf8.data(), utf8.length());
+}
+
+void AppendJsonEscaped(std::string_view value, std::string *out) {
+    const char *data = value.data();
+    const size_t size = value.size();
+    size_t clean_start = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        if (size - pos >= sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + pos, sizeof(word));
+            if (!NeedsEscape(word)) {
+                pos += sizeof(word);
+                continue;
+            }
+        }
+        const size_t end = std::min(size, pos + sizeof(uint64_t));
+        for (; pos < end; ++pos) {
+            const auto ch = static_cast<unsigned char>(data[pos]);
+            if (!NeedsEscape(ch)) {
+                continue;
+            }
+            out->append(data + clean_start, pos - clean_start);
+            AppendEscape(ch, out);
+            clean_start = pos + 1;
+        }
+    }
+    out->append(data + clean_start, size - clean_start);
+}
+
+wxString EscapeJson(const wxString &value) {
+    const std::string utf8 = ToUtf8(value);
+    std::string escaped;
+    escaped.reserve(utf8.size());
+    AppendJsonEscaped(utf8, &escaped);
+    return wxString::FromUTF8(escaped.data(), escaped.size());
+}
+
+bool EndsWithNoCase(const wxString &text, std::string_view suffix) {
+    if (text.length() < suffix.size()) {
+        return false;
+    }
+    auto it = text.end();
+    for (auto expected = suffix.rbegin(); expected != suffix.rend(); ++expected) {
+        --it;
+        const auto ch = static_cast<uint32_t>(*it);
+        if (FoldCase(ch) != FoldCase(static_cast<unsigned char>(*expected))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t ParseDurationSeconds(std::string_view text) {
+    auto skip_spaces = [&text]() {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+            text.remove_prefix(1);
+        }
+    };
+    auto read_number = [&text](double *number) {
+        size_t length = 0;
+        while (length < text.size() &&
+               ((text[length] >= '0' && text[length] <= '9') || text[length] == '.')) {
+            ++length;
+        }
+        if (length == 0) {
+            return false;
+        }
+        *number = std::strtod(std::string(text.substr(0, length)).c_str(), nullptr);
+        text.remove_prefix(length);
+        return true;
+    };
+    auto unit_scale = [](uint32_t unit) {
+        switch (unit) {
+        case 'd':
+            return 86400.0;
+        case 'h':
+            return 3600.0;
+        case 'm':
+            return 60.0;
+        case 's':
+            return 1.0;
+        default:
+            return 0.0;
+        }
+    };
+
+    skip_spaces();
+    double total = 0.0;
+    bool any = false;
+    if (text.find(':') != std::string_view::npos) {
+        double part = 0.0;
+        while (read_number(&part)) {
+            total = total * 60.0 + part;
+            any = true;
+            if (text.empty() || text.front() != ':') {
+                break;
+            }
+            text.remove_prefix(1);
+        }
+    } else {
+        double part = 0.0;
+        while (read_number(&part)) {
+            skip_spaces();
+            // A bare number is seconds.
+            const double scale =
+                text.empty() ? 1.0 : unit_scale(FoldCase(static_cast<unsigned char>(text[0])));
+            if (scale == 0.0) {
+                return -1;
+            }
+            total += part * scale;
+            any = true;
+            while (!text.empty() && std::isalpha(static_cast<unsigned char>(text.front()))) {
+                text.remove_prefix(1);
+            }
+            skip_spaces();
+        }
+    }
+    skip_spaces();
+    if (!any || !text.empty()) {
+        return -1;
+    }
+    return static_cast<int64_t>(total + 0.5);
+}
+
+std::string_view FormatUnsigned(uint64_t value, std::array<char, 20> *buffer) {
+    const auto result = std::to_chars(buffer->data(), buffer->data() + buffer->size(), value);
+    return std::string_view(buffer->data(), static_cast<size_t>(result.ptr - buffer->data()));
+}
+
+std::string CommandTemplate::Render(std::initializer_list<std::string_view> values) const {
+    size_t size = literal_size_;
+    for (const std::string_view value : values) {
+        size += value.size();
+    }
+    std::string rendered;
+    rendered.reserve(size);
+    auto value = values.begin();
+    for (size_t index = 0; index < splice_count_; ++index) {
+        rendered.append(pieces_[index]);
+        if (value != values.end()) {
+            AppendJsonEscaped(*value++, &rendered);
+        }
+    }
+    rendered.append(pieces_[splice_count_]);
+    return rendered;
+}
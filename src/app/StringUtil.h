@@ -0,0 +1,64 @@
+#pragma once
+
+#include <wx/string.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+std::string ToUtf8(const wxString &value);
+
+// Appends |value| to |out| with the characters JSON requires escaped (quote,
+// backslash and control characters). The input is scanned eight bytes at a time
+// and runs that need no escaping are copied in one piece. Multi-byte UTF-8
+// sequences pass through untouched.
+void AppendJsonEscaped(std::string_view value, std::string *out);
+wxString EscapeJson(const wxString &value);
+
+// ASCII case-insensitive; compares the tail of |text| in place without lowering a copy.
+bool EndsWithNoCase(const wxString &text, std::string_view suffix);
+
+// Seconds in a slicer time estimate: a bare number of seconds, "h:mm:ss" or
+// "mm:ss", or unit-tagged parts such as "1d 2h 3m 4s". Returns -1 if unparseable.
+int64_t ParseDurationSeconds(std::string_view text);
+
+// Decimal text of |value| written into |buffer|, for splicing without an allocation.
+std::string_view FormatUnsigned(uint64_t value, std::array<char, 20> *buffer);
+
+// A command payload whose constant text is split once, at compile time, around
+// its "%s" splice points. Render copies the pieces and the JSON-escaped values
+// into a string sized up front, so building a command is a handful of appends.
+class CommandTemplate {
+public:
+    static constexpr size_t kMaxSplices = 8;
+
+    constexpr explicit CommandTemplate(std::string_view pattern) {
+        size_t start = 0;
+        while (splice_count_ < kMaxSplices) {
+            const size_t splice = pattern.find("%s", start);
+            if (splice == std::string_view::npos) {
+                break;
+            }
+            pieces_[splice_count_++] = pattern.substr(start, splice - start);
+            start = splice + 2;
+        }
+        pieces_[splice_count_] = pattern.substr(start);
+        for (size_t index = 0; index <= splice_count_; ++index) {
+            literal_size_ += pieces_[index].size();
+        }
+    }
+
+    constexpr size_t GetSpliceCount() const { return splice_count_; }
+
+    // Values fill the splice points in order; missing ones are left empty and
+    // extra ones are ignored.
+    std::string Render(std::initializer_list<std::string_view> values) const;
+
+private:
+    std::array<std::string_view, kMaxSplices + 1> pieces_{};
+    size_t splice_count_ = 0;
+    size_t literal_size_ = 0;
+};
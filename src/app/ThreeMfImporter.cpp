@@ -1,5 +1,7 @@
 #include "app/ThreeMfImporter.h"
 
+#include "app/StringUtil.h"
+
 #include <wx/filename.h>
 #include <wx/log.h>
 #include <wx/regex.h>
@@ -13,17 +15,21 @@
 
 namespace {
 bool IsThumbnailEntry(const wxString &entry_name) {
-    const wxString lower = entry_name.Lower();
-    return lower.EndsWith("thumbnail.png") || lower.EndsWith("thumbnail.jpg") ||
-           lower.EndsWith("thumbnail.jpeg");
+    return EndsWithNoCase(entry_name, "thumbnail.png") ||
+           EndsWithNoCase(entry_name, "thumbnail.jpg") ||
+           EndsWithNoCase(entry_name, "thumbnail.jpeg");
 }
 
 bool IsMetadataEntry(const wxString &entry_name) {
-    return entry_name.Lower().EndsWith("metadata.xml");
+    return EndsWithNoCase(entry_name, "metadata.xml");
+}
+
+bool IsSliceInfoEntry(const wxString &entry_name) {
+    return EndsWithNoCase(entry_name, "slice_info.config");
 }
 
 bool IsGcodeEntry(const wxString &entry_name) {
-    return entry_name.Lower().EndsWith(".gcode");
+    return EndsWithNoCase(entry_name, ".gcode");
 }
 
 wxString NormalizeMetadataName(const wxString &name) {
@@ -136,6 +142,7 @@ bool ThreeMfImporter::Extract3mfData(const wxString &file_path,
     std::unique_ptr<wxZipEntry> entry;
     std::vector<wxString> gcode_entries;
     wxString metadata_entry;
+    wxString slice_info_entry;
     wxString thumb_entry;
 
     while ((entry.reset(zip_stream.GetNextEntry())), entry) {
@@ -151,6 +158,9 @@ bool ThreeMfImporter::Extract3mfData(const wxString &file_path,
         if (metadata_entry.empty() && IsMetadataEntry(entry_name)) {
             metadata_entry = entry_name;
         }
+        if (slice_info_entry.empty() && IsSliceInfoEntry(entry_name)) {
+            slice_info_entry = entry_name;
+        }
         if (IsGcodeEntry(entry_name)) {
             gcode_entries.push_back(entry_name);
         }
@@ -171,6 +181,11 @@ bool ThreeMfImporter::Extract3mfData(const wxString &file_path,
 
     if (plates) {
         PopulatePlatesFromEntries(gcode_entries, plates);
+        wxString slice_info;
+        if (!slice_info_entry.empty() &&
+            ReadEntryText(file_path, slice_info_entry, &slice_info, nullptr)) {
+            ParseSliceInfoXml(slice_info, plates);
+        }
     }
 
     return true;
@@ -222,6 +237,17 @@ bool ThreeMfImporter::ReadMetadataEntry(const wxString &file_path,
                                         const wxString &entry_name,
                                         PrintMetadata *metadata,
                                         wxString *error_message) {
+    wxString xml_text;
+    if (!ReadEntryText(file_path, entry_name, &xml_text, error_message) || xml_text.empty()) {
+        return false;
+    }
+    return ParseMetadataXml(xml_text, metadata);
+}
+
+bool ThreeMfImporter::ReadEntryText(const wxString &file_path,
+                                    const wxString &entry_name,
+                                    wxString *text,
+                                    wxString *error_message) {
     wxFileInputStream file_stream(file_path);
     if (!file_stream.IsOk()) {
         if (error_message) {
@@ -242,14 +268,10 @@ bool ThreeMfImporter::ReadMetadataEntry(const wxString &file_path,
             continue;
         }
 
-        wxString xml_text;
-        wxStringOutputStream output(&xml_text);
+        wxStringOutputStream output(text);
         output.Write(zip_stream);
         zip_stream.CloseEntry();
-        if (xml_text.empty()) {
-            return false;
-        }
-        return ParseMetadataXml(xml_text, metadata);
+        return true;
     }
 
     if (error_message) {
@@ -304,6 +326,47 @@ bool ThreeMfImporter::ParseMetadataXml(const wxString &xml_text, PrintMetadata *
     return true;
 }
 
+// Bambu Studio lists each plate's filament in Metadata/slice_info.config:
+//   <plate><metadata key="index" value="1"/><filament id="1" type="PLA" color="#FFFFFF"/>
+// The filament id is the slot the plate's G-code refers to.
+void ThreeMfImporter::ParseSliceInfoXml(const wxString &xml_text,
+                                        std::vector<PlateDefinition> *plates) const {
+    wxStringInputStream input(xml_text);
+    wxXmlDocument doc;
+    if (!doc.Load(input) || !doc.GetRoot()) {
+        return;
+    }
+
+    for (wxXmlNode *plate = doc.GetRoot()->GetChildren(); plate; plate = plate->GetNext()) {
+        if (plate->GetName() != "plate") {
+            continue;
+        }
+        long plate_index = 0;
+        std::vector<FilamentRecord> filaments;
+        for (wxXmlNode *node = plate->GetChildren(); node; node = node->GetNext()) {
+            if (node->GetName() == "metadata" && node->GetAttribute("key", "") == "index") {
+                node->GetAttribute("value", "").ToLong(&plate_index);
+            } else if (node->GetName() == "filament") {
+                long slot = 0;
+                if (!node->GetAttribute("id", "").ToLong(&slot) || slot < 1) {
+                    continue;
+                }
+                FilamentRecord filament;
+                filament.slot = static_cast<int>(slot);
+                filament.material = node->GetAttribute("type", "");
+                filament.color_hex = node->GetAttribute("color", "");
+                filaments.push_back(std::move(filament));
+            }
+        }
+        auto match = std::find_if(plates->begin(), plates->end(), [plate_index](const auto &p) {
+            return p.plate_index == plate_index;
+        });
+        if (match != plates->end()) {
+            match->filaments = std::move(filaments);
+        }
+    }
+}
+
 wxString ThreeMfImporter::BuildMetadataJson(const PrintMetadata &metadata) const {
     wxString json = "{";
     bool first = true;
@@ -326,27 +389,6 @@ wxString ThreeMfImporter::BuildMetadataJson(const PrintMetadata &metadata) const
     return first ? wxString() : json;
 }
 
-wxString ThreeMfImporter::EscapeJson(const wxString &value) const {
-    wxString escaped;
-    escaped.reserve(value.size());
-    for (const wxUniChar ch : value) {
-        if (ch == '\\') {
-            escaped += "\\\\";
-        } else if (ch == '"') {
-            escaped += "\\\"";
-        } else if (ch == '\n') {
-            escaped += "\\n";
-        } else if (ch == '\r') {
-            escaped += "\\r";
-        } else if (ch == '\t') {
-            escaped += "\\t";
-        } else {
-            escaped += ch;
-        }
-    }
-    return escaped;
-}
-
 wxString ThreeMfImporter::ResolveUniquePath(const wxString &directory,
                                             const wxString &base_name,
                                             const wxString &extension) const {
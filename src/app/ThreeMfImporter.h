@@ -33,9 +33,13 @@ private:
                            const wxString &entry_name,
                            PrintMetadata *metadata,
                            wxString *error_message);
+    bool ReadEntryText(const wxString &file_path,
+                       const wxString &entry_name,
+                       wxString *text,
+                       wxString *error_message);
     bool ParseMetadataXml(const wxString &xml_text, PrintMetadata *metadata);
+    void ParseSliceInfoXml(const wxString &xml_text, std::vector<PlateDefinition> *plates) const;
     wxString BuildMetadataJson(const PrintMetadata &metadata) const;
-    wxString EscapeJson(const wxString &value) const;
     wxString ResolveUniquePath(const wxString &directory,
                                const wxString &base_name,
                                const wxString &extension) const;
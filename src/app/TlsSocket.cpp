@@ -0,0 +1,305 @@
+#include "app/TlsSocket.h"
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+
+namespace {
+class TlsContext {
+public:
+    TlsContext() {
+        std::signal(SIGPIPE, SIG_IGN);
+        ctx_ = SSL_CTX_new(TLS_client_method());
+        if (ctx_) {
+            SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+            // Bambu printers present a self-signed certificate in LAN mode.
+            SSL_CTX_set_verify(ctx_, SSL_VERIFY_NONE, nullptr);
+            // Writes are retried from a growing outbox, one record at a time.
+            SSL_CTX_set_mode(ctx_,
+                             SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        }
+    }
+    ~TlsContext() {
+        if (ctx_) {
+            SSL_CTX_free(ctx_);
+        }
+    }
+
+    SSL_CTX *Get() const { return ctx_; }
+
+private:
+    SSL_CTX *ctx_ = nullptr;
+};
+
+SSL_CTX *SharedTlsContext() {
+    static TlsContext context;
+    return context.Get();
+}
+
+wxString LastTlsError() {
+    const unsigned long code = ERR_get_error();
+    if (code == 0) {
+        return "unknown TLS error";
+    }
+    char buffer[256];
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    return wxString::FromUTF8(buffer);
+}
+
+int StartTcpConnect(const wxString &host, int port, wxString *error_message) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *results = nullptr;
+    const wxString service = wxString::Format("%d", port);
+    const int rc = getaddrinfo(host.utf8_str(), service.utf8_str(), &hints, &results);
+    if (rc != 0 || !results) {
+        if (error_message) {
+            *error_message = wxString::Format("unable to resolve %s: %s", host, gai_strerror(rc));
+        }
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo *entry = results; entry; entry = entry->ai_next) {
+        fd = socket(entry->ai_family, entry->ai_socktype, entry->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (connect(fd, entry->ai_addr, entry->ai_addrlen) == 0 || errno == EINPROGRESS) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+
+    if (fd < 0 && error_message) {
+        *error_message = wxString::Format("unable to connect to %s:%d", host, port);
+    }
+    return fd;
+}
+}  // namespace
+
+TlsSocket::TlsSocket()
+    : fd_(-1),
+      ssl_(nullptr),
+      resume_session_(nullptr),
+      use_tls_(true),
+      tcp_connected_(false),
+      established_(false) {}
+
+TlsSocket::~TlsSocket() {
+    Close();
+    if (resume_session_) {
+        SSL_SESSION_free(resume_session_);
+        resume_session_ = nullptr;
+    }
+}
+
+bool TlsSocket::BeginConnect(const wxString &host,
+                             int port,
+                             bool use_tls,
+                             wxString *error_message) {
+    Close();
+    use_tls_ = use_tls;
+
+    SSL_CTX *ctx = SharedTlsContext();
+    if (!ctx) {
+        if (error_message) {
+            *error_message = "TLS connect failed: unable to create TLS context.";
+        }
+        return false;
+    }
+
+    wxString tcp_error;
+    fd_ = StartTcpConnect(host, port, &tcp_error);
+    if (fd_ < 0) {
+        if (error_message) {
+            *error_message = "TLS connect failed: " + tcp_error;
+        }
+        return false;
+    }
+    if (!use_tls_) {
+        return true;
+    }
+
+    ssl_ = SSL_new(ctx);
+    if (!ssl_ || SSL_set_fd(ssl_, fd_) != 1) {
+        if (error_message) {
+            *error_message = "TLS connect failed: " + LastTlsError();
+        }
+        Close();
+        return false;
+    }
+    if (resume_session_) {
+        SSL_set_session(ssl_, resume_session_);
+    }
+    return true;
+}
+
+TlsConnectStatus TlsSocket::ContinueConnect(bool *want_write, wxString *error_message) {
+    if (want_write) {
+        *want_write = false;
+    }
+    if (fd_ < 0) {
+        if (error_message) {
+            *error_message = "TLS connect failed: connection is closed.";
+        }
+        return TlsConnectStatus::Failed;
+    }
+    if (established_) {
+        return TlsConnectStatus::Connected;
+    }
+
+    if (!tcp_connected_) {
+        pollfd pfd{fd_, POLLOUT, 0};
+        if (poll(&pfd, 1, 0) != 1) {
+            if (want_write) {
+                *want_write = true;
+            }
+            return TlsConnectStatus::InProgress;
+        }
+        int socket_error = 0;
+        socklen_t length = sizeof(socket_error);
+        if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &socket_error, &length) != 0 ||
+            socket_error != 0) {
+            if (error_message) {
+                *error_message = wxString::Format("TLS connect failed: TCP connect error %d",
+                                                  socket_error);
+            }
+            return TlsConnectStatus::Failed;
+        }
+        tcp_connected_ = true;
+        if (!use_tls_) {
+            established_ = true;
+            return TlsConnectStatus::Connected;
+        }
+    }
+
+    ERR_clear_error();
+    const int rc = SSL_connect(ssl_);
+    if (rc == 1) {
+        established_ = true;
+        return TlsConnectStatus::Connected;
+    }
+    const int ssl_error = SSL_get_error(ssl_, rc);
+    if (ssl_error == SSL_ERROR_WANT_READ || ssl_error == SSL_ERROR_WANT_WRITE) {
+        if (want_write) {
+            *want_write = ssl_error == SSL_ERROR_WANT_WRITE;
+        }
+        return TlsConnectStatus::InProgress;
+    }
+    if (error_message) {
+        *error_message = "TLS handshake failed: " + LastTlsError();
+    }
+    return TlsConnectStatus::Failed;
+}
+
+void TlsSocket::Close() {
+    if (ssl_) {
+        if (established_) {
+            SSL_SESSION *session = SSL_get1_session(ssl_);
+            if (session && SSL_SESSION_is_resumable(session)) {
+                if (resume_session_) {
+                    SSL_SESSION_free(resume_session_);
+                }
+                resume_session_ = session;
+            } else if (session) {
+                SSL_SESSION_free(session);
+            }
+            SSL_shutdown(ssl_);
+        }
+        SSL_free(ssl_);
+        ssl_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    tcp_connected_ = false;
+    established_ = false;
+}
+
+bool TlsSocket::IsOpen() const {
+    return fd_ >= 0;
+}
+
+bool TlsSocket::IsEstablished() const {
+    return established_;
+}
+
+bool TlsSocket::SessionReused() const {
+    return ssl_ && SSL_session_reused(ssl_) == 1;
+}
+
+int TlsSocket::GetFd() const {
+    return fd_;
+}
+
+long TlsSocket::Read(char *buffer, size_t size) {
+    if (!established_) {
+        return -1;
+    }
+    if (!use_tls_) {
+        const ssize_t bytes = recv(fd_, buffer, size, 0);
+        if (bytes > 0) {
+            return static_cast<long>(bytes);
+        }
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return 0;
+        }
+        return -1;
+    }
+    ERR_clear_error();
+    const int rc = SSL_read(ssl_, buffer, static_cast<int>(size));
+    if (rc > 0) {
+        return rc;
+    }
+    const int ssl_error = SSL_get_error(ssl_, rc);
+    if (ssl_error == SSL_ERROR_WANT_READ || ssl_error == SSL_ERROR_WANT_WRITE) {
+        return 0;
+    }
+    return -1;
+}
+
+long TlsSocket::WriteSome(const char *data, size_t size) {
+    if (!established_) {
+        return -1;
+    }
+    if (!use_tls_) {
+        const ssize_t bytes = send(fd_, data, size, 0);
+        if (bytes >= 0) {
+            return static_cast<long>(bytes);
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        return -1;
+    }
+    ERR_clear_error();
+    const int rc = SSL_write(ssl_, data, static_cast<int>(size));
+    if (rc > 0) {
+        return rc;
+    }
+    const int ssl_error = SSL_get_error(ssl_, rc);
+    if (ssl_error == SSL_ERROR_WANT_READ || ssl_error == SSL_ERROR_WANT_WRITE) {
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <wx/string.h>
+
+#include <cstddef>
+
+typedef struct ssl_st SSL;
+typedef struct ssl_session_st SSL_SESSION;
+
+enum class TlsConnectStatus {
+    InProgress,
+    Connected,
+    Failed,
+};
+
+class TlsSocket {
+public:
+    TlsSocket();
+    ~TlsSocket();
+
+    TlsSocket(const TlsSocket &) = delete;
+    TlsSocket &operator=(const TlsSocket &) = delete;
+
+    // With use_tls false the socket carries plain TCP, for local brokers that do not
+    // terminate TLS.
+    bool BeginConnect(const wxString &host, int port, bool use_tls, wxString *error_message);
+    TlsConnectStatus ContinueConnect(bool *want_write, wxString *error_message);
+    void Close();
+    bool IsOpen() const;
+    bool IsEstablished() const;
+    bool SessionReused() const;
+    int GetFd() const;
+
+    // Returns the number of bytes read, 0 when no data is ready, or -1 once the
+    // peer has closed the connection or the session failed.
+    long Read(char *buffer, size_t size);
+    // Never blocks. Returns the number of bytes taken, 0 when the socket cannot take
+    // any now, or -1 once the session failed. After 0, retry with the same bytes
+    // at the front of |data|.
+    long WriteSome(const char *data, size_t size);
+
+private:
+    int fd_;
+    SSL *ssl_;
+    SSL_SESSION *resume_session_;
+    bool use_tls_;
+    bool tcp_connected_;
+    bool established_;
+};
@@ -0,0 +1,74 @@
+#include "app/WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::~WorkerPool() {
+    Stop();
+}
+
+void WorkerPool::Start(size_t thread_count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            return;
+        }
+        running_ = true;
+    }
+    thread_count = std::max<size_t>(1, thread_count);
+    threads_.reserve(thread_count);
+    for (size_t index = 0; index < thread_count; ++index) {
+        threads_.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+void WorkerPool::Stop() {
+    std::deque<Entry> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        dropped.swap(tasks_);
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+    for (Entry &entry : dropped) {
+        if (entry.cancel) {
+            entry.cancel();
+        }
+    }
+}
+
+bool WorkerPool::Post(Task task) {
+    return Post(std::move(task), nullptr);
+}
+
+bool WorkerPool::Post(Task task, Task cancel) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return false;
+        }
+        tasks_.push_back({std::move(task), std::move(cancel)});
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void WorkerPool::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+        if (!running_) {
+            return;
+        }
+        Task task = std::move(tasks_.front().task);
+        tasks_.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
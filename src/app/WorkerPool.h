@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that run posted tasks in submission order. Meant for
+// work that blocks for seconds at a time, such as FTPS uploads, and so must not
+// run on a reactor thread or the report drain thread.
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    WorkerPool() = default;
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void Start(size_t thread_count);
+    // Tasks already running are waited for; tasks still queued are dropped, and the
+    // |cancel| given with each of them runs instead, on the calling thread.
+    void Stop();
+    // Returns false, and drops |task|, if the pool is not running.
+    bool Post(Task task);
+    bool Post(Task task, Task cancel);
+
+private:
+    struct Entry {
+        Task task;
+        Task cancel;
+    };
+
+    void WorkerLoop();
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Entry> tasks_;
+    bool running_ = false;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,218 @@
+#include "app/JsonStructuralIndex.h"
+#include "app/PrinterReport.h"
+#include "app/ReportRecording.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+void PrintUsage(const char *program) {
+    std::printf(
+        "Usage: %s RECORDING [options]\n"
+        "  --iterations N   timed passes over the recording, best is reported (default 20)\n"
+        "\n"
+        "RECORDING is a file written with [diagnostics] record_reports.\n",
+        program);
+}
+
+// The find-based extraction the coordinator used before reports were parsed
+// into PrinterReport, kept here as the baseline.
+std::optional<std::string> LegacyExtractString(const std::string &data, const std::string &key) {
+    const std::string needle = "\"" + key + "\"";
+    size_t pos = data.find(needle);
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    pos = data.find(':', pos);
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    ++pos;
+    while (pos < data.size() && std::isspace(static_cast<unsigned char>(data[pos]))) {
+        ++pos;
+    }
+    if (pos >= data.size() || data[pos] != '"') {
+        return std::nullopt;
+    }
+    ++pos;
+    std::string value;
+    while (pos < data.size()) {
+        const char ch = data[pos];
+        if (ch == '"') {
+            break;
+        }
+        if (ch == '\\' && pos + 1 < data.size()) {
+            const char next = data[pos + 1];
+            if (next == '"' || next == '\\') {
+                value += next;
+                pos += 2;
+                continue;
+            }
+        }
+        value += ch;
+        ++pos;
+    }
+    return value;
+}
+
+std::optional<int> LegacyExtractInt(const std::string &data, const std::string &key) {
+    const std::string needle = "\"" + key + "\"";
+    size_t pos = data.find(needle);
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    pos = data.find(':', pos);
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    ++pos;
+    while (pos < data.size() && std::isspace(static_cast<unsigned char>(data[pos]))) {
+        ++pos;
+    }
+    std::string number;
+    while (pos < data.size() &&
+           (std::isdigit(static_cast<unsigned char>(data[pos])) || data[pos] == '-' ||
+            data[pos] == '.')) {
+        number += data[pos];
+        ++pos;
+    }
+    if (number.empty()) {
+        return std::nullopt;
+    }
+    return static_cast<int>(std::strtod(number.c_str(), nullptr));
+}
+
+// Pulls the scalar fields of PrinterReport one key at a time. AMS trays and HMS
+// codes were never reachable this way, so the baseline does less work than the
+// parsers it is compared with.
+void LegacyExtract(const std::string &payload, PrinterReport *report) {
+    *report = PrinterReport{};
+    report->command = LegacyExtractString(payload, "command");
+    report->sequence_id = LegacyExtractString(payload, "sequence_id");
+    report->gcode_state = LegacyExtractString(payload, "gcode_state");
+    report->gcode_file = LegacyExtractString(payload, "gcode_file");
+    report->subtask_name = LegacyExtractString(payload, "subtask_name");
+    report->percent = LegacyExtractInt(payload, "mc_percent");
+    report->remaining_minutes = LegacyExtractInt(payload, "mc_remaining_time");
+    report->layer = LegacyExtractInt(payload, "layer_num");
+    report->total_layers = LegacyExtractInt(payload, "total_layer_num");
+    report->print_error = LegacyExtractInt(payload, "print_error");
+    report->nozzle_temp = LegacyExtractInt(payload, "nozzle_temper");
+    report->nozzle_target = LegacyExtractInt(payload, "nozzle_target_temper");
+    report->bed_temp = LegacyExtractInt(payload, "bed_temper");
+    report->bed_target = LegacyExtractInt(payload, "bed_target_temper");
+    report->chamber_temp = LegacyExtractInt(payload, "chamber_temper");
+}
+
+struct PayloadSet {
+    const char *name;
+    std::vector<const std::string *> payloads;
+    uint64_t bytes = 0;
+};
+
+void RunCase(const char *name,
+             const PayloadSet &set,
+             int iterations,
+             const std::function<void(const std::string &payload)> &parse) {
+    if (set.payloads.empty()) {
+        return;
+    }
+    double best_seconds = 0.0;
+    for (int pass = 0; pass < iterations; ++pass) {
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::string *payload : set.payloads) {
+            parse(*payload);
+        }
+        const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best_seconds = pass == 0 ? seconds : std::min(best_seconds, seconds);
+    }
+    std::printf("  %-16s %10.0f ns/report %10.1f MB/s\n",
+                name,
+                best_seconds * 1e9 / static_cast<double>(set.payloads.size()),
+                static_cast<double>(set.bytes) / best_seconds / 1e6);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+        PrintUsage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+    int iterations = 20;
+    for (int index = 2; index < argc; ++index) {
+        const std::string flag = argv[index];
+        if (flag == "--iterations" && index + 1 < argc) {
+            iterations = std::max(1, std::atoi(argv[++index]));
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return 1;
+        }
+    }
+
+    ReportRecordingReader reader;
+    wxString error;
+    if (!reader.Open(wxString::FromUTF8(argv[1]), &error)) {
+        std::fprintf(stderr, "%s\n", static_cast<const char *>(error.utf8_str()));
+        return 1;
+    }
+    std::vector<std::string> payloads;
+    RecordedReport report;
+    while (reader.Next(&report)) {
+        payloads.push_back(std::move(report.payload));
+    }
+
+    PayloadSet all{"all reports", {}, 0};
+    // Split where ParsePrinterReport switches to the indexed path, so "default"
+    // can be checked against the streaming and indexed parsers on both sides.
+    PayloadSet large{"indexed-size reports", {}, 0};
+    PayloadSet small{"streamed-size reports", {}, 0};
+    for (const auto &payload : payloads) {
+        PayloadSet &bucket = payload.size() >= kIndexedParseThreshold ? large : small;
+        for (PayloadSet *set : {&all, &bucket}) {
+            set->payloads.push_back(&payload);
+            set->bytes += payload.size();
+        }
+    }
+    std::printf("%zu reports, %zu at least %zu bytes, structural index backend: %s\n",
+                payloads.size(),
+                large.payloads.size(),
+                kIndexedParseThreshold,
+                JsonStructuralIndex::Backend());
+
+    PrinterReport parsed;
+    JsonStructuralIndex index;
+    for (const PayloadSet *set : {&all, &large, &small}) {
+        if (set->payloads.empty()) {
+            continue;
+        }
+        std::printf("%s (%zu, %.0f bytes average)\n",
+                    set->name,
+                    set->payloads.size(),
+                    static_cast<double>(set->bytes) / static_cast<double>(set->payloads.size()));
+        RunCase("legacy extract", *set, iterations, [&parsed](const std::string &payload) {
+            LegacyExtract(payload, &parsed);
+        });
+        RunCase("streaming", *set, iterations, [&parsed](const std::string &payload) {
+            ParsePrinterReport(payload, nullptr, &parsed);
+        });
+        RunCase("index only", *set, iterations, [&index](const std::string &payload) {
+            index.Build(payload);
+        });
+        RunCase("indexed", *set, iterations, [&index, &parsed](const std::string &payload) {
+            index.Build(payload);
+            ParsePrinterReport(payload, &index, &parsed);
+        });
+        RunCase("default", *set, iterations, [&parsed](const std::string &payload) {
+            ParsePrinterReport(payload, &parsed);
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "simulator/SimulatedPrinter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+constexpr double kNozzleTarget = 220.0;
+constexpr double kBedTarget = 65.0;
+constexpr double kAmbientTemp = 25.0;
+constexpr double kHeatRatePerSecond = 0.35;
+
+std::string FindJsonString(std::string_view payload, std::string_view key) {
+    const std::string needle = "\"" + std::string(key) + "\"";
+    size_t pos = payload.find(needle);
+    if (pos == std::string_view::npos) {
+        return std::string();
+    }
+    pos = payload.find(':', pos + needle.size());
+    if (pos == std::string_view::npos) {
+        return std::string();
+    }
+    pos = payload.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string_view::npos || payload[pos] != '"') {
+        return std::string();
+    }
+    std::string value;
+    for (++pos; pos < payload.size() && payload[pos] != '"'; ++pos) {
+        if (payload[pos] == '\\' && pos + 1 < payload.size()) {
+            ++pos;
+        }
+        value.push_back(payload[pos]);
+    }
+    return value;
+}
+
+std::string CommandSection(std::string_view payload) {
+    const size_t open = payload.find('"');
+    if (open == std::string_view::npos) {
+        return std::string();
+    }
+    const size_t close = payload.find('"', open + 1);
+    if (close == std::string_view::npos) {
+        return std::string();
+    }
+    return std::string(payload.substr(open + 1, close - open - 1));
+}
+
+std::string BuildAck(const std::string &section,
+                     const std::string &command,
+                     const std::string &sequence_id,
+                     const char *result,
+                     const char *reason) {
+    return "{\"" + section + "\":{\"command\":\"" + command + "\",\"sequence_id\":\"" +
+           sequence_id + "\",\"result\":\"" + result + "\",\"reason\":\"" + reason + "\"}}";
+}
+
+const char *StateName(SimulatedPrintState state) {
+    switch (state) {
+    case SimulatedPrintState::Idle:
+        return "IDLE";
+    case SimulatedPrintState::Prepare:
+        return "PREPARE";
+    case SimulatedPrintState::Running:
+        return "RUNNING";
+    case SimulatedPrintState::Pause:
+        return "PAUSE";
+    case SimulatedPrintState::Finish:
+        return "FINISH";
+    case SimulatedPrintState::Failed:
+        return "FAILED";
+    }
+    return "IDLE";
+}
+
+double Approach(double current, double target, double seconds) {
+    const double factor = 1.0 - std::exp(-kHeatRatePerSecond * seconds);
+    return current + (target - current) * factor;
+}
+}  // namespace
+
+std::string SimulatedSerial(const SimulatorOptions &options, size_t index) {
+    char serial[64];
+    std::snprintf(serial, sizeof(serial), "%s%06zu", options.serial_prefix.c_str(), index + 1);
+    return serial;
+}
+
+SimulatedPrinter::SimulatedPrinter(std::string serial, uint32_t seed)
+    : serial_(std::move(serial)),
+      random_(seed),
+      state_started_(std::chrono::steady_clock::now()),
+      last_advance_(state_started_) {}
+
+const std::string &SimulatedPrinter::GetSerial() const {
+    return serial_;
+}
+
+SimulatedPrintState SimulatedPrinter::GetState() const {
+    return state_;
+}
+
+SimulatedCommandResult SimulatedPrinter::HandleCommand(std::string_view payload,
+                                                       std::chrono::steady_clock::time_point now) {
+    SimulatedCommandResult outcome;
+    const std::string section = CommandSection(payload);
+    const std::string command = FindJsonString(payload, "command");
+    const std::string sequence_id = FindJsonString(payload, "sequence_id");
+
+    if (command == "pushall") {
+        outcome.wants_full_report = true;
+        return outcome;
+    }
+
+    const bool busy = state_ == SimulatedPrintState::Prepare ||
+                      state_ == SimulatedPrintState::Running ||
+                      state_ == SimulatedPrintState::Pause;
+    if (command == "project_file") {
+        std::string file = FindJsonString(payload, "file");
+        if (file.empty()) {
+            file = FindJsonString(payload, "param");
+        }
+        if (busy) {
+            outcome.ack_payload = BuildAck(section, command, sequence_id, "failed", "printer busy");
+            return outcome;
+        }
+        previous_file_ = gcode_file_;
+        gcode_file_ = file;
+        print_elapsed_seconds_ = 0.0;
+        total_layers_ = 100 + static_cast<int>(random_() % 400);
+        EnterState(SimulatedPrintState::Prepare, now);
+        outcome.job_started = true;
+        outcome.ack_payload = BuildAck(section, command, sequence_id, "success", "");
+        return outcome;
+    }
+    if (command == "pause" && busy && state_ != SimulatedPrintState::Pause) {
+        EnterState(SimulatedPrintState::Pause, now);
+    } else if (command == "resume" && state_ == SimulatedPrintState::Pause) {
+        EnterState(SimulatedPrintState::Running, now);
+    } else if (command == "stop" && busy) {
+        EnterState(SimulatedPrintState::Failed, now);
+    } else if (command == "ledctrl") {
+        light_on_ = FindJsonString(payload, "led_mode") != "off";
+    } else if (command == "pause" || command == "resume" || command == "stop") {
+        outcome.ack_payload = BuildAck(section, command, sequence_id, "failed", "invalid state");
+        return outcome;
+    }
+    if (!sequence_id.empty()) {
+        outcome.ack_payload = BuildAck(section, command, sequence_id, "success", "");
+    }
+    return outcome;
+}
+
+bool SimulatedPrinter::Advance(std::chrono::steady_clock::time_point now,
+                               const SimulatorOptions &options) {
+    const double seconds = std::chrono::duration<double>(now - last_advance_).count();
+    last_advance_ = now;
+    const double in_state = std::chrono::duration<double>(now - state_started_).count();
+
+    bool finished = false;
+    const bool heating = state_ == SimulatedPrintState::Prepare ||
+                         state_ == SimulatedPrintState::Running ||
+                         state_ == SimulatedPrintState::Pause;
+    nozzle_temp_ = Approach(nozzle_temp_, heating ? kNozzleTarget : kAmbientTemp, seconds);
+    bed_temp_ = Approach(bed_temp_, heating ? kBedTarget : kAmbientTemp, seconds);
+    chamber_temp_ = Approach(chamber_temp_, heating ? 35.0 : kAmbientTemp, seconds / 10.0);
+
+    if (state_ == SimulatedPrintState::Prepare && in_state >= options.prepare_seconds) {
+        EnterState(SimulatedPrintState::Running, now);
+    } else if (state_ == SimulatedPrintState::Running) {
+        print_elapsed_seconds_ += seconds;
+        if (print_elapsed_seconds_ >= options.print_seconds) {
+            EnterState(SimulatedPrintState::Finish, now);
+            finished = true;
+        }
+    }
+    percent_ = Percent(options);
+    const double remaining_seconds =
+        std::max(0.0, options.print_seconds - print_elapsed_seconds_);
+    remaining_minutes_ = state_ == SimulatedPrintState::Finish ||
+                                 state_ == SimulatedPrintState::Idle
+                             ? 0
+                             : static_cast<int>(std::ceil(remaining_seconds / 60.0));
+    return finished;
+}
+
+std::string SimulatedPrinter::BuildReport(bool full, bool stale_file) {
+    std::string file = gcode_file_;
+    if (stale_file) {
+        file = previous_file_.empty() ? "stale_" + serial_ + ".3mf" : previous_file_;
+    }
+    const int layer = total_layers_ * percent_ / 100;
+    std::normal_distribution<double> noise(0.0, 0.3);
+
+    char buffer[1024];
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  "\"gcode_state\":\"%s\",\"gcode_file\":\"%s\",\"subtask_name\":\"%s\","
+                  "\"mc_percent\":%d,\"mc_remaining_time\":%d,\"layer_num\":%d,"
+                  "\"total_layer_num\":%d,\"nozzle_temper\":%.1f,\"nozzle_target_temper\":%.1f,"
+                  "\"bed_temper\":%.1f,\"bed_target_temper\":%.1f,\"chamber_temper\":%.1f,"
+                  "\"print_error\":0,\"wifi_signal\":\"-%udBm\"",
+                  StateName(state_),
+                  file.c_str(),
+                  file.c_str(),
+                  percent_,
+                  remaining_minutes_,
+                  layer,
+                  total_layers_,
+                  nozzle_temp_ + noise(random_),
+                  state_ == SimulatedPrintState::Idle ? 0.0 : kNozzleTarget,
+                  bed_temp_ + noise(random_),
+                  state_ == SimulatedPrintState::Idle ? 0.0 : kBedTarget,
+                  chamber_temp_,
+                  40u + static_cast<unsigned int>(random_() % 30));
+
+    std::string report = "{\"print\":{";
+    report += buffer;
+    if (full) {
+        static const char *const kMaterials[] = {"PLA", "PETG", "ABS", "TPU"};
+        static const char *const kColors[] = {"FFFFFFFF", "000000FF", "F72323FF", "2850E0FF"};
+        report += ",\"ams\":{\"ams\":[";
+        for (int unit = 0; unit < 2; ++unit) {
+            std::snprintf(buffer,
+                          sizeof(buffer),
+                          "%s{\"id\":\"%d\",\"humidity\":\"%u\",\"temp\":\"%.1f\",\"tray\":[",
+                          unit == 0 ? "" : ",",
+                          unit,
+                          1u + static_cast<unsigned int>(random_() % 5),
+                          chamber_temp_);
+            report += buffer;
+            for (int tray = 0; tray < 4; ++tray) {
+                const int slot = (unit * 4 + tray + static_cast<int>(serial_.back())) % 4;
+                std::snprintf(buffer,
+                              sizeof(buffer),
+                              "%s{\"id\":\"%d\",\"tray_type\":\"%s\",\"tray_color\":\"%s\","
+                              "\"tray_sub_brands\":\"Bambu %s Basic\",\"nozzle_temp_min\":\"190\","
+                              "\"nozzle_temp_max\":\"240\",\"remain\":%u,\"tray_weight\":\"1000\","
+                              "\"tray_diameter\":\"1.75\",\"bed_temp\":\"35\"}",
+                              tray == 0 ? "" : ",",
+                              tray,
+                              kMaterials[slot],
+                              kColors[(slot + tray) % 4],
+                              kMaterials[slot],
+                              static_cast<unsigned int>(random_() % 101));
+                report += buffer;
+            }
+            report += "]}";
+        }
+        report += "],\"ams_exist_bits\":\"3\",\"tray_now\":\"0\",\"version\":4},";
+        report += "\"hms\":[],";
+        std::snprintf(buffer,
+                      sizeof(buffer),
+                      "\"lights_report\":[{\"node\":\"chamber_light\",\"mode\":\"%s\"}],"
+                      "\"ipcam\":{\"ipcam_dev\":\"1\",\"ipcam_record\":\"enable\","
+                      "\"timelapse\":\"disable\",\"resolution\":\"1080p\"},"
+                      "\"xcam\":{\"allow_skip_parts\":false,\"buildplate_marker_detector\":true,"
+                      "\"first_layer_inspector\":true,\"halt_print_sensitivity\":\"medium\","
+                      "\"print_halt\":true,\"printing_monitor\":true,\"spaghetti_detector\":true},"
+                      "\"upgrade_state\":{\"sequence_id\":0,\"progress\":\"\",\"status\":\"\","
+                      "\"consistency_request\":false,\"dis_state\":0,\"err_code\":0,"
+                      "\"force_upgrade\":false,\"message\":\"\",\"module\":\"\","
+                      "\"new_version_state\":2,\"new_ver_list\":[]},"
+                      "\"upload\":{\"status\":\"idle\",\"progress\":0,\"message\":\"\"},"
+                      "\"nozzle_diameter\":\"0.4\",\"nozzle_type\":\"hardened_steel\","
+                      "\"spd_lvl\":2,\"spd_mag\":100,\"stg\":[],\"stg_cur\":-1,"
+                      "\"sdcard\":true,\"home_flag\":6292887,\"lifecycle\":\"product\"",
+                      light_on_ ? "on" : "off");
+        report += buffer;
+    }
+    std::snprintf(buffer,
+                  sizeof(buffer),
+                  ",\"command\":\"push_status\",\"msg\":%d,\"sequence_id\":\"%llu\"}}",
+                  full ? 0 : 1,
+                  static_cast<unsigned long long>(report_sequence_++));
+    report += buffer;
+    return report;
+}
+
+int SimulatedPrinter::Percent(const SimulatorOptions &options) const {
+    if (state_ == SimulatedPrintState::Finish) {
+        return 100;
+    }
+    if (state_ == SimulatedPrintState::Idle || options.print_seconds <= 0) {
+        return 0;
+    }
+    const double fraction = print_elapsed_seconds_ / options.print_seconds;
+    return std::clamp(static_cast<int>(fraction * 100.0), 0, 99);
+}
+
+void SimulatedPrinter::EnterState(SimulatedPrintState state,
+                                  std::chrono::steady_clock::time_point now) {
+    state_ = state;
+    state_started_ = now;
+}
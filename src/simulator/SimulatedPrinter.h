@@ -0,0 +1,63 @@
+#pragma once
+
+#include "simulator/SimulatorOptions.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+enum class SimulatedPrintState {
+    Idle,
+    Prepare,
+    Running,
+    Pause,
+    Finish,
+    Failed,
+};
+
+struct SimulatedCommandResult {
+    std::string ack_payload;
+    bool wants_full_report = false;
+    bool job_started = false;
+};
+
+// Serial of the |index|-th (zero-based) printer in the simulated fleet.
+std::string SimulatedSerial(const SimulatorOptions &options, size_t index);
+
+class SimulatedPrinter {
+public:
+    SimulatedPrinter(std::string serial, uint32_t seed);
+
+    const std::string &GetSerial() const;
+    SimulatedPrintState GetState() const;
+
+    SimulatedCommandResult HandleCommand(std::string_view payload,
+                                         std::chrono::steady_clock::time_point now);
+    // Advances the print and heater model. Returns true when a job finished during
+    // this step.
+    bool Advance(std::chrono::steady_clock::time_point now, const SimulatorOptions &options);
+    std::string BuildReport(bool full, bool stale_file);
+
+private:
+    int Percent(const SimulatorOptions &options) const;
+    void EnterState(SimulatedPrintState state, std::chrono::steady_clock::time_point now);
+
+    std::string serial_;
+    std::mt19937 random_;
+    SimulatedPrintState state_ = SimulatedPrintState::Idle;
+    std::chrono::steady_clock::time_point state_started_;
+    std::chrono::steady_clock::time_point last_advance_;
+    std::string gcode_file_;
+    std::string previous_file_;
+    double print_elapsed_seconds_ = 0.0;
+    int percent_ = 0;
+    int remaining_minutes_ = 0;
+    int total_layers_ = 0;
+    double nozzle_temp_ = 25.0;
+    double bed_temp_ = 25.0;
+    double chamber_temp_ = 25.0;
+    bool light_on_ = true;
+    uint64_t report_sequence_ = 0;
+};
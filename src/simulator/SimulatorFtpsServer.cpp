@@ -0,0 +1,297 @@
+#include "simulator/SimulatorFtpsServer.h"
+
+#include "simulator/SimulatorNet.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <openssl/ssl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace {
+constexpr int kAcceptPollMs = 200;
+constexpr int kDataConnectTimeoutMs = 10000;
+constexpr size_t kMaxCommandLine = 4096;
+constexpr char kFtpUsername[] = "bblp";
+
+bool SendReply(SSL *ssl, const std::string &reply) {
+    const std::string line = reply + "\r\n";
+    return SSL_write(ssl, line.data(), static_cast<int>(line.size())) ==
+           static_cast<int>(line.size());
+}
+
+bool ReadCommand(SSL *ssl, std::string *buffer, std::string *line) {
+    while (true) {
+        const size_t end = buffer->find('\n');
+        if (end != std::string::npos) {
+            *line = buffer->substr(0, end);
+            buffer->erase(0, end + 1);
+            if (!line->empty() && line->back() == '\r') {
+                line->pop_back();
+            }
+            return true;
+        }
+        if (buffer->size() > kMaxCommandLine) {
+            return false;
+        }
+        char chunk[1024];
+        const int bytes = SSL_read(ssl, chunk, sizeof(chunk));
+        if (bytes <= 0) {
+            return false;
+        }
+        buffer->append(chunk, static_cast<size_t>(bytes));
+    }
+}
+
+std::string LocalAddress(int fd) {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        return "127.0.0.1";
+    }
+    char text[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &address.sin_addr, text, sizeof(text));
+    return text;
+}
+
+std::string BaseName(const std::string &path) {
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+SSL *AcceptDataConnection(SSL_CTX *context, int passive_fd, int *data_fd) {
+    pollfd poll_fd{passive_fd, POLLIN, 0};
+    if (poll(&poll_fd, 1, kDataConnectTimeoutMs) <= 0) {
+        return nullptr;
+    }
+    const int fd = accept(passive_fd, nullptr, nullptr);
+    if (fd < 0) {
+        return nullptr;
+    }
+    SSL *ssl = SSL_new(context);
+    SSL_set_fd(ssl, fd);
+    if (SSL_accept(ssl) != 1) {
+        SSL_free(ssl);
+        close(fd);
+        return nullptr;
+    }
+    *data_fd = fd;
+    return ssl;
+}
+
+void CloseDataConnection(SSL *ssl, int fd) {
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(fd);
+}
+}  // namespace
+
+SimulatorFtpsServer::SimulatorFtpsServer(const SimulatorOptions &options,
+                                         SSL_CTX *context,
+                                         SimulatorStats *stats)
+    : options_(options), context_(context), stats_(stats) {}
+
+SimulatorFtpsServer::~SimulatorFtpsServer() {
+    Stop();
+}
+
+bool SimulatorFtpsServer::Start(std::string *error_message) {
+    listen_fd_ = OpenListenSocket(options_.bind_address, options_.ftps_port, error_message);
+    if (listen_fd_ < 0) {
+        return false;
+    }
+    accept_thread_ = std::thread([this]() { AcceptLoop(); });
+    return true;
+}
+
+void SimulatorFtpsServer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        for (const int fd : session_fds_) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    for (auto &thread : session_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    session_threads_.clear();
+}
+
+void SimulatorFtpsServer::AcceptLoop() {
+    while (true) {
+        pollfd poll_fd{listen_fd_, POLLIN, 0};
+        const int ready = poll(&poll_fd, 1, kAcceptPollMs);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        session_fds_.insert(fd);
+        session_threads_.emplace_back([this, fd]() { ServeSession(fd); });
+    }
+}
+
+void SimulatorFtpsServer::ServeSession(int fd) {
+    SSL *ssl = SSL_new(context_);
+    SSL_set_fd(ssl, fd);
+    if (SSL_accept(ssl) == 1 && SendReply(ssl, "220 Bambu simulator FTPS ready")) {
+        std::string buffer;
+        std::string line;
+        std::string user;
+        bool logged_in = false;
+        int passive_fd = -1;
+        while (ReadCommand(ssl, &buffer, &line)) {
+            const size_t space = line.find(' ');
+            std::string verb = line.substr(0, space);
+            const std::string argument = space == std::string::npos ? "" : line.substr(space + 1);
+            std::transform(verb.begin(), verb.end(), verb.begin(), [](unsigned char ch) {
+                return static_cast<char>(std::toupper(ch));
+            });
+
+            bool ok = true;
+            if (verb == "USER") {
+                user = argument;
+                ok = SendReply(ssl, "331 Password required");
+            } else if (verb == "PASS") {
+                logged_in = user == kFtpUsername && argument == options_.access_code;
+                ok = SendReply(ssl, logged_in ? "230 Logged in" : "530 Login incorrect");
+            } else if (verb == "QUIT") {
+                SendReply(ssl, "221 Goodbye");
+                break;
+            } else if (!logged_in) {
+                ok = SendReply(ssl, "530 Not logged in");
+            } else if (verb == "PBSZ") {
+                ok = SendReply(ssl, "200 PBSZ=0");
+            } else if (verb == "PROT" || verb == "TYPE" || verb == "OPTS" || verb == "NOOP") {
+                ok = SendReply(ssl, "200 OK");
+            } else if (verb == "PWD") {
+                ok = SendReply(ssl, "257 \"/\" is current directory");
+            } else if (verb == "CWD") {
+                ok = SendReply(ssl, "250 OK");
+            } else if (verb == "SYST") {
+                ok = SendReply(ssl, "215 UNIX Type: L8");
+            } else if (verb == "EPSV" || verb == "PASV") {
+                if (passive_fd >= 0) {
+                    close(passive_fd);
+                }
+                const std::string local = LocalAddress(fd);
+                passive_fd = OpenListenSocket(local, 0, nullptr);
+                const int port = passive_fd >= 0 ? GetLocalPort(passive_fd) : -1;
+                if (port < 0) {
+                    ok = SendReply(ssl, "425 Cannot open passive connection");
+                } else if (verb == "EPSV") {
+                    ok = SendReply(ssl,
+                                   "229 Entering Extended Passive Mode (|||" +
+                                       std::to_string(port) + "|)");
+                } else {
+                    std::string host = local;
+                    std::replace(host.begin(), host.end(), '.', ',');
+                    ok = SendReply(ssl,
+                                   "227 Entering Passive Mode (" + host + "," +
+                                       std::to_string(port / 256) + "," +
+                                       std::to_string(port % 256) + ")");
+                }
+            } else if (verb == "STOR" || verb == "LIST" || verb == "NLST") {
+                if (passive_fd < 0) {
+                    ok = SendReply(ssl, "425 Use PASV or EPSV first");
+                    continue;
+                }
+                ok = SendReply(ssl, "150 Opening data connection");
+                int data_fd = -1;
+                SSL *data = ok ? AcceptDataConnection(context_, passive_fd, &data_fd) : nullptr;
+                close(passive_fd);
+                passive_fd = -1;
+                if (!data) {
+                    ok = ok && SendReply(ssl, "425 Data connection failed");
+                    continue;
+                }
+                if (verb == "STOR") {
+                    uint64_t received = 0;
+                    char chunk[64 * 1024];
+                    int bytes = 0;
+                    while ((bytes = SSL_read(data, chunk, sizeof(chunk))) > 0) {
+                        received += static_cast<uint64_t>(bytes);
+                    }
+                    CloseDataConnection(data, data_fd);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        files_[BaseName(argument)] = received;
+                    }
+                    stats_->uploads += 1;
+                    stats_->bytes_uploaded += received;
+                } else {
+                    std::string listing;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        for (const auto &file : files_) {
+                            if (verb == "NLST") {
+                                listing += file.first + "\r\n";
+                                continue;
+                            }
+                            char entry[512];
+                            std::snprintf(entry,
+                                          sizeof(entry),
+                                          "-rw-rw-rw- 1 bblp bblp %llu Jan 01 00:00 %s\r\n",
+                                          static_cast<unsigned long long>(file.second),
+                                          file.first.c_str());
+                            listing += entry;
+                        }
+                    }
+                    if (!listing.empty()) {
+                        SSL_write(data, listing.data(), static_cast<int>(listing.size()));
+                    }
+                    CloseDataConnection(data, data_fd);
+                }
+                ok = SendReply(ssl, "226 Transfer complete");
+            } else if (verb == "SIZE" || verb == "DELE") {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = files_.find(BaseName(argument));
+                if (it == files_.end()) {
+                    ok = SendReply(ssl, "550 No such file");
+                } else if (verb == "SIZE") {
+                    ok = SendReply(ssl, "213 " + std::to_string(it->second));
+                } else {
+                    files_.erase(it);
+                    ok = SendReply(ssl, "250 Deleted");
+                }
+            } else {
+                ok = SendReply(ssl, "502 Command not implemented");
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        if (passive_fd >= 0) {
+            close(passive_fd);
+        }
+    }
+
+    SSL_free(ssl);
+    std::lock_guard<std::mutex> lock(mutex_);
+    session_fds_.erase(fd);
+    close(fd);
+}
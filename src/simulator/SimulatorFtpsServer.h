@@ -0,0 +1,43 @@
+#pragma once
+
+#include "simulator/SimulatorOptions.h"
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+// Implicit-TLS FTP endpoint that accepts uploads the way the printer's SD card
+// does. File contents are discarded; only names and sizes are kept so LIST and
+// SIZE behave like the real printer.
+class SimulatorFtpsServer {
+public:
+    SimulatorFtpsServer(const SimulatorOptions &options, SSL_CTX *context, SimulatorStats *stats);
+    ~SimulatorFtpsServer();
+
+    SimulatorFtpsServer(const SimulatorFtpsServer &) = delete;
+    SimulatorFtpsServer &operator=(const SimulatorFtpsServer &) = delete;
+
+    bool Start(std::string *error_message);
+    void Stop();
+
+private:
+    void AcceptLoop();
+    void ServeSession(int fd);
+
+    const SimulatorOptions &options_;
+    SSL_CTX *context_;
+    SimulatorStats *stats_;
+    int listen_fd_ = -1;
+    std::thread accept_thread_;
+    std::mutex mutex_;
+    bool stopping_ = false;
+    std::list<std::thread> session_threads_;
+    std::set<int> session_fds_;
+    std::map<std::string, uint64_t> files_;
+};
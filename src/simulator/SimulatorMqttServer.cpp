@@ -0,0 +1,430 @@
+#include "simulator/SimulatorMqttServer.h"
+
+#include "simulator/SimulatorNet.h"
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+namespace {
+constexpr int kPollIntervalMs = 10;
+constexpr size_t kMaxOutboxBytes = 32 * 1024 * 1024;
+constexpr char kMqttUsername[] = "bblp";
+constexpr uint8_t kConnackNotAuthorized = 5;
+
+std::string SerialFromTopic(std::string_view topic, std::string_view suffix) {
+    constexpr std::string_view kPrefix = "device/";
+    if (topic.size() <= kPrefix.size() + suffix.size() ||
+        topic.substr(0, kPrefix.size()) != kPrefix ||
+        topic.substr(topic.size() - suffix.size()) != suffix) {
+        return std::string();
+    }
+    topic.remove_prefix(kPrefix.size());
+    topic.remove_suffix(suffix.size());
+    return std::string(topic);
+}
+
+std::string ReportTopic(const std::string &serial) {
+    return "device/" + serial + "/report";
+}
+}  // namespace
+
+SimulatorMqttServer::SimulatorMqttServer(const SimulatorOptions &options,
+                                         SSL_CTX *context,
+                                         SimulatorStats *stats)
+    : options_(options), context_(context), stats_(stats), random_(options.seed) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(options.report_rate_hz, 0.01)));
+    printers_.reserve(options.printer_count);
+    for (size_t index = 0; index < options.printer_count; ++index) {
+        const std::string serial = SimulatedSerial(options, index);
+        printers_.emplace_back(serial, options.seed + static_cast<uint32_t>(index));
+        printer_index_[serial] = index;
+        next_report_.push_back(now + period * static_cast<long>(index) /
+                                         static_cast<long>(options.printer_count));
+    }
+    next_fault_check_ = now + std::chrono::seconds(1);
+}
+
+SimulatorMqttServer::~SimulatorMqttServer() {
+    for (auto &connection : connections_) {
+        CloseConnection(connection.get());
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+}
+
+bool SimulatorMqttServer::Listen(std::string *error_message) {
+    listen_fd_ = OpenListenSocket(options_.bind_address, options_.mqtt_port, error_message);
+    if (listen_fd_ < 0) {
+        return false;
+    }
+    SetNonBlocking(listen_fd_);
+    return true;
+}
+
+void SimulatorMqttServer::Run(const std::atomic<bool> &running) {
+    std::vector<pollfd> poll_fds;
+    while (running.load()) {
+        poll_fds.clear();
+        poll_fds.push_back(pollfd{listen_fd_, POLLIN, 0});
+        for (const auto &connection : connections_) {
+            short events = POLLIN;
+            if (connection->want_write || connection->outbox_offset < connection->outbox.size()) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back(pollfd{connection->fd, events, 0});
+        }
+
+        poll(poll_fds.data(), poll_fds.size(), kPollIntervalMs);
+
+        const size_t serviced = connections_.size();
+        for (size_t index = 0; index < serviced; ++index) {
+            if (poll_fds[index + 1].revents != 0) {
+                ServiceConnection(connections_[index].get(), poll_fds[index + 1].revents);
+            }
+        }
+        if (poll_fds[0].revents & POLLIN) {
+            AcceptConnections();
+        }
+        Tick(std::chrono::steady_clock::now());
+        RemoveClosedConnections();
+    }
+}
+
+void SimulatorMqttServer::AcceptConnections() {
+    while (true) {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        SetNonBlocking(fd);
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->ssl = SSL_new(context_);
+        SSL_set_fd(connection->ssl, fd);
+        SSL_set_accept_state(connection->ssl);
+        connections_.push_back(std::move(connection));
+        stats_->active_connections += 1;
+    }
+}
+
+void SimulatorMqttServer::ServiceConnection(Connection *connection, short revents) {
+    if (connection->fd < 0) {
+        return;
+    }
+    if ((revents & (POLLERR | POLLNVAL)) != 0) {
+        CloseConnection(connection);
+        return;
+    }
+    connection->want_write = false;
+    if (!connection->handshake_done) {
+        ERR_clear_error();
+        const int result = SSL_accept(connection->ssl);
+        if (result != 1) {
+            const int error = SSL_get_error(connection->ssl, result);
+            if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+                connection->want_write = error == SSL_ERROR_WANT_WRITE;
+            } else {
+                CloseConnection(connection);
+            }
+            return;
+        }
+        connection->handshake_done = true;
+    }
+    ReadFrames(connection);
+    Flush(connection);
+}
+
+void SimulatorMqttServer::ReadFrames(Connection *connection) {
+    while (connection->fd >= 0) {
+        size_t writable = 0;
+        char *region = connection->reader.WritableRegion(&writable);
+        ERR_clear_error();
+        const int bytes = SSL_read(connection->ssl,
+                                   region,
+                                   static_cast<int>(std::min<size_t>(writable, INT_MAX)));
+        if (bytes <= 0) {
+            const int error = SSL_get_error(connection->ssl, bytes);
+            if (error == SSL_ERROR_WANT_WRITE) {
+                connection->want_write = true;
+            } else if (error != SSL_ERROR_WANT_READ) {
+                CloseConnection(connection);
+            }
+            return;
+        }
+        connection->reader.Commit(static_cast<size_t>(bytes));
+
+        MqttPacket packet;
+        bool malformed = false;
+        while (connection->fd >= 0 && connection->reader.Next(&packet, &malformed)) {
+            HandlePacket(connection, packet);
+        }
+        if (malformed) {
+            CloseConnection(connection);
+        }
+    }
+}
+
+void SimulatorMqttServer::HandlePacket(Connection *connection, const MqttPacket &packet) {
+    if (packet.type == MqttPacketType::Connect) {
+        MqttConnectOptions connect;
+        if (!DecodeMqttConnect(packet, &connect)) {
+            CloseConnection(connection);
+            return;
+        }
+        connection->authenticated =
+            connect.username == kMqttUsername && connect.password == options_.access_code;
+        Enqueue(connection,
+                EncodeMqttConnack(connection->authenticated ? 0 : kConnackNotAuthorized));
+        if (connection->authenticated) {
+            stats_->connections += 1;
+        } else {
+            std::fprintf(stderr,
+                         "SimulatorMqttServer: rejected client %s (bad credentials)\n",
+                         connect.client_id.c_str());
+            connection->closing = true;
+        }
+        return;
+    }
+    if (!connection->authenticated) {
+        CloseConnection(connection);
+        return;
+    }
+
+    switch (packet.type) {
+    case MqttPacketType::Subscribe: {
+        uint16_t packet_id = 0;
+        std::vector<std::string> topics;
+        if (!DecodeMqttSubscribe(packet, &packet_id, &topics)) {
+            CloseConnection(connection);
+            return;
+        }
+        connection->filters.insert(connection->filters.end(), topics.begin(), topics.end());
+        routes_dirty_ = true;
+        Enqueue(connection, EncodeMqttSuback(packet_id, std::vector<uint8_t>(topics.size(), 0)));
+        break;
+    }
+    case MqttPacketType::Publish: {
+        MqttPublishView publish;
+        if (!DecodeMqttPublish(packet, &publish)) {
+            CloseConnection(connection);
+            return;
+        }
+        if (publish.qos > 0) {
+            Enqueue(connection, EncodeMqttPuback(publish.packet_id));
+        }
+        const std::string serial = SerialFromTopic(publish.topic, "/request");
+        if (!serial.empty()) {
+            HandleCommand(serial, publish.payload);
+        }
+        break;
+    }
+    case MqttPacketType::Pingreq:
+        Enqueue(connection, EncodeMqttPingresp());
+        break;
+    case MqttPacketType::Disconnect:
+        CloseConnection(connection);
+        break;
+    default:
+        break;
+    }
+}
+
+void SimulatorMqttServer::HandleCommand(const std::string &serial, std::string_view payload) {
+    auto it = printer_index_.find(serial);
+    if (it == printer_index_.end()) {
+        return;
+    }
+    stats_->commands_received += 1;
+    SimulatedPrinter &printer = printers_[it->second];
+    const auto now = std::chrono::steady_clock::now();
+    const SimulatedCommandResult result = printer.HandleCommand(payload, now);
+    if (result.job_started) {
+        stats_->jobs_started += 1;
+    }
+    if (!result.ack_payload.empty()) {
+        if (options_.ack_delay_ms > 0) {
+            const auto due = now + std::chrono::milliseconds(options_.ack_delay_ms);
+            delayed_.push_back(DelayedMessage{due, ReportTopic(serial), result.ack_payload});
+        } else {
+            Publish(ReportTopic(serial), result.ack_payload);
+            stats_->acks_sent += 1;
+        }
+    }
+    if (result.wants_full_report) {
+        Publish(ReportTopic(serial), printer.BuildReport(true, false));
+    }
+}
+
+void SimulatorMqttServer::Publish(const std::string &topic, const std::string &payload) {
+    if (routes_dirty_) {
+        RebuildRoutes();
+    }
+    std::vector<Connection *> targets;
+    auto it = exact_routes_.find(topic);
+    if (it != exact_routes_.end()) {
+        targets = it->second;
+    }
+    for (Connection *connection : wildcard_routes_) {
+        for (const auto &filter : connection->filters) {
+            if (MqttTopicMatches(filter, topic)) {
+                targets.push_back(connection);
+                break;
+            }
+        }
+    }
+    if (targets.empty()) {
+        return;
+    }
+
+    const std::string packet = EncodeMqttPublish(topic, payload);
+    for (Connection *connection : targets) {
+        if (connection->fd < 0) {
+            continue;
+        }
+        Enqueue(connection, packet);
+        Flush(connection);
+    }
+    stats_->reports_published += 1;
+    stats_->bytes_published += payload.size();
+}
+
+void SimulatorMqttServer::Enqueue(Connection *connection, const std::string &packet) {
+    if (connection->outbox.size() - connection->outbox_offset + packet.size() > kMaxOutboxBytes) {
+        std::fprintf(stderr, "SimulatorMqttServer: dropping slow client (outbox full)\n");
+        CloseConnection(connection);
+        return;
+    }
+    connection->outbox.append(packet);
+}
+
+void SimulatorMqttServer::Flush(Connection *connection) {
+    while (connection->fd >= 0 && connection->outbox_offset < connection->outbox.size()) {
+        const size_t pending = connection->outbox.size() - connection->outbox_offset;
+        ERR_clear_error();
+        const int written = SSL_write(connection->ssl,
+                                      connection->outbox.data() + connection->outbox_offset,
+                                      static_cast<int>(std::min<size_t>(pending, INT_MAX)));
+        if (written <= 0) {
+            const int error = SSL_get_error(connection->ssl, written);
+            if (error == SSL_ERROR_WANT_WRITE) {
+                connection->want_write = true;
+            } else if (error != SSL_ERROR_WANT_READ) {
+                CloseConnection(connection);
+            }
+            return;
+        }
+        connection->outbox_offset += static_cast<size_t>(written);
+    }
+    if (connection->fd < 0) {
+        return;
+    }
+    connection->outbox.clear();
+    connection->outbox_offset = 0;
+    if (connection->closing) {
+        CloseConnection(connection);
+    }
+}
+
+void SimulatorMqttServer::Tick(std::chrono::steady_clock::time_point now) {
+    if (!delayed_.empty()) {
+        std::vector<DelayedMessage> due;
+        auto split = std::stable_partition(delayed_.begin(),
+                                           delayed_.end(),
+                                           [now](const DelayedMessage &message) {
+                                               return message.due > now;
+                                           });
+        std::move(split, delayed_.end(), std::back_inserter(due));
+        delayed_.erase(split, delayed_.end());
+        for (const auto &message : due) {
+            Publish(message.topic, message.payload);
+            stats_->acks_sent += 1;
+        }
+    }
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(options_.report_rate_hz, 0.01)));
+    std::bernoulli_distribution stale(std::clamp(options_.stale_file_rate, 0.0, 1.0));
+    for (size_t index = 0; index < printers_.size(); ++index) {
+        if (now < next_report_[index]) {
+            continue;
+        }
+        next_report_[index] += period;
+        if (next_report_[index] < now) {
+            next_report_[index] = now + period;
+        }
+        SimulatedPrinter &printer = printers_[index];
+        if (printer.Advance(now, options_)) {
+            stats_->jobs_finished += 1;
+        }
+        Publish(ReportTopic(printer.GetSerial()), printer.BuildReport(false, stale(random_)));
+    }
+
+    if (now >= next_fault_check_) {
+        next_fault_check_ = now + std::chrono::seconds(1);
+        if (options_.drop_rate > 0.0) {
+            std::bernoulli_distribution drop(std::clamp(options_.drop_rate, 0.0, 1.0));
+            for (auto &connection : connections_) {
+                if (connection->fd >= 0 && connection->authenticated && drop(random_)) {
+                    CloseConnection(connection.get());
+                    stats_->dropped_connections += 1;
+                }
+            }
+        }
+    }
+}
+
+void SimulatorMqttServer::RebuildRoutes() {
+    exact_routes_.clear();
+    wildcard_routes_.clear();
+    for (const auto &connection : connections_) {
+        if (connection->fd < 0 || !connection->authenticated) {
+            continue;
+        }
+        bool wildcard = false;
+        for (const auto &filter : connection->filters) {
+            if (filter.find_first_of("+#") != std::string::npos) {
+                wildcard = true;
+            } else {
+                exact_routes_[filter].push_back(connection.get());
+            }
+        }
+        if (wildcard) {
+            wildcard_routes_.push_back(connection.get());
+        }
+    }
+    routes_dirty_ = false;
+}
+
+void SimulatorMqttServer::CloseConnection(Connection *connection) {
+    if (connection->fd < 0) {
+        return;
+    }
+    SSL_free(connection->ssl);
+    connection->ssl = nullptr;
+    close(connection->fd);
+    connection->fd = -1;
+    routes_dirty_ = true;
+    stats_->active_connections -= 1;
+}
+
+void SimulatorMqttServer::RemoveClosedConnections() {
+    const auto closed = std::remove_if(connections_.begin(),
+                                       connections_.end(),
+                                       [](const std::unique_ptr<Connection> &connection) {
+                                           return connection->fd < 0;
+                                       });
+    if (closed != connections_.end()) {
+        connections_.erase(closed, connections_.end());
+        routes_dirty_ = true;
+    }
+}
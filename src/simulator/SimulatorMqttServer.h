@@ -0,0 +1,78 @@
+#pragma once
+
+#include "app/MqttPacket.h"
+#include "simulator/SimulatedPrinter.h"
+#include "simulator/SimulatorOptions.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
+// Single-threaded TLS MQTT endpoint that hosts every virtual printer. Clients may
+// subscribe per printer (`device/<serial>/report`) or fan in with wildcards.
+class SimulatorMqttServer {
+public:
+    SimulatorMqttServer(const SimulatorOptions &options, SSL_CTX *context, SimulatorStats *stats);
+    ~SimulatorMqttServer();
+
+    SimulatorMqttServer(const SimulatorMqttServer &) = delete;
+    SimulatorMqttServer &operator=(const SimulatorMqttServer &) = delete;
+
+    bool Listen(std::string *error_message);
+    void Run(const std::atomic<bool> &running);
+
+private:
+    struct Connection {
+        int fd = -1;
+        SSL *ssl = nullptr;
+        bool handshake_done = false;
+        bool authenticated = false;
+        bool closing = false;
+        bool want_write = false;
+        MqttFrameReader reader;
+        std::string outbox;
+        size_t outbox_offset = 0;
+        std::vector<std::string> filters;
+    };
+
+    struct DelayedMessage {
+        std::chrono::steady_clock::time_point due;
+        std::string topic;
+        std::string payload;
+    };
+
+    void AcceptConnections();
+    void ServiceConnection(Connection *connection, short revents);
+    void ReadFrames(Connection *connection);
+    void HandlePacket(Connection *connection, const MqttPacket &packet);
+    void HandleCommand(const std::string &serial, std::string_view payload);
+    void Publish(const std::string &topic, const std::string &payload);
+    void Enqueue(Connection *connection, const std::string &packet);
+    void Flush(Connection *connection);
+    void Tick(std::chrono::steady_clock::time_point now);
+    void RebuildRoutes();
+    void CloseConnection(Connection *connection);
+    void RemoveClosedConnections();
+
+    const SimulatorOptions &options_;
+    SSL_CTX *context_;
+    SimulatorStats *stats_;
+    int listen_fd_ = -1;
+    std::mt19937 random_;
+    std::vector<SimulatedPrinter> printers_;
+    std::vector<std::chrono::steady_clock::time_point> next_report_;
+    std::unordered_map<std::string, size_t> printer_index_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::unordered_map<std::string, std::vector<Connection *>> exact_routes_;
+    std::vector<Connection *> wildcard_routes_;
+    bool routes_dirty_ = true;
+    std::chrono::steady_clock::time_point next_fault_check_;
+    std::vector<DelayedMessage> delayed_;
+};
@@ -0,0 +1,83 @@
+#include "simulator/SimulatorNet.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace {
+constexpr int kListenBacklog = 1024;
+}  // namespace
+
+int OpenListenSocket(const std::string &address, int port, std::string *error_message) {
+    sockaddr_in bind_address{};
+    bind_address.sin_family = AF_INET;
+    bind_address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &bind_address.sin_addr) != 1) {
+        if (error_message) {
+            *error_message = "invalid bind address " + address;
+        }
+        return -1;
+    }
+
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        if (error_message) {
+            *error_message = std::string("socket failed: ") + std::strerror(errno);
+        }
+        return -1;
+    }
+    const int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (bind(fd, reinterpret_cast<sockaddr *>(&bind_address), sizeof(bind_address)) != 0 ||
+        listen(fd, kListenBacklog) != 0) {
+        if (error_message) {
+            *error_message = address + ":" + std::to_string(port) + ": " + std::strerror(errno);
+        }
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool SetNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return false;
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return true;
+}
+
+int GetLocalPort(int fd) {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        return -1;
+    }
+    return ntohs(address.sin_port);
+}
+
+void RaiseFileDescriptorLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    rlim_t target = limit.rlim_max;
+#ifdef __APPLE__
+    if (target == RLIM_INFINITY || target > 10240) {
+        target = 10240;
+    }
+#endif
+    if (limit.rlim_cur < target) {
+        limit.rlim_cur = target;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+int OpenListenSocket(const std::string &address, int port, std::string *error_message);
+bool SetNonBlocking(int fd);
+int GetLocalPort(int fd);
+void RaiseFileDescriptorLimit();
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct SimulatorOptions {
+    size_t printer_count = 10;
+    int mqtt_port = 8883;
+    int ftps_port = 990;
+    int ssdp_port = 0;
+    std::string bind_address = "0.0.0.0";
+    std::string advertised_host = "127.0.0.1";
+    std::string access_code = "12345678";
+    std::string serial_prefix = "SIM";
+    double report_rate_hz = 1.0;
+    int prepare_seconds = 5;
+    int print_seconds = 120;
+    double drop_rate = 0.0;
+    double stale_file_rate = 0.0;
+    int ack_delay_ms = 0;
+    int stats_interval_seconds = 5;
+    std::string config_path;
+    uint32_t seed = 1;
+};
+
+struct SimulatorStats {
+    std::atomic<uint64_t> connections{0};
+    std::atomic<uint64_t> active_connections{0};
+    std::atomic<uint64_t> reports_published{0};
+    std::atomic<uint64_t> bytes_published{0};
+    std::atomic<uint64_t> commands_received{0};
+    std::atomic<uint64_t> jobs_started{0};
+    std::atomic<uint64_t> jobs_finished{0};
+    std::atomic<uint64_t> acks_sent{0};
+    std::atomic<uint64_t> dropped_connections{0};
+    std::atomic<uint64_t> uploads{0};
+    std::atomic<uint64_t> bytes_uploaded{0};
+};
@@ -0,0 +1,123 @@
+#include "simulator/SimulatorSsdpResponder.h"
+
+#include "simulator/SimulatedPrinter.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+namespace {
+constexpr int kPollMs = 200;
+constexpr char kSearchTarget[] = "urn:bambulab-com:device:3dprinter:1";
+constexpr char kSimulatedModel[] = "C12";
+}  // namespace
+
+SimulatorSsdpResponder::SimulatorSsdpResponder(const SimulatorOptions &options)
+    : options_(options) {}
+
+SimulatorSsdpResponder::~SimulatorSsdpResponder() {
+    Stop();
+}
+
+bool SimulatorSsdpResponder::Start(std::string *error_message) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options_.ssdp_port));
+    if (inet_pton(AF_INET, options_.bind_address.c_str(), &address.sin_addr) != 1) {
+        *error_message = "invalid bind address " + options_.bind_address;
+        return false;
+    }
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+        *error_message = std::string("socket failed: ") + std::strerror(errno);
+        return false;
+    }
+    const int enable = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        *error_message = "UDP port " + std::to_string(options_.ssdp_port) + ": " +
+                         std::strerror(errno);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    thread_ = std::thread([this]() { Run(); });
+    return true;
+}
+
+void SimulatorSsdpResponder::Stop() {
+    stopping_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+void SimulatorSsdpResponder::Run() {
+    char datagram[2048];
+    while (!stopping_.load()) {
+        pollfd poll_fd{fd_, POLLIN, 0};
+        if (poll(&poll_fd, 1, kPollMs) <= 0) {
+            continue;
+        }
+        sockaddr_in sender{};
+        socklen_t sender_length = sizeof(sender);
+        const ssize_t bytes = recvfrom(fd_,
+                                       datagram,
+                                       sizeof(datagram),
+                                       0,
+                                       reinterpret_cast<sockaddr *>(&sender),
+                                       &sender_length);
+        if (bytes <= 0) {
+            continue;
+        }
+        const std::string_view request(datagram, static_cast<size_t>(bytes));
+        if (request.substr(0, 8) != "M-SEARCH" ||
+            (request.find(kSearchTarget) == std::string_view::npos &&
+             request.find("ssdp:all") == std::string_view::npos)) {
+            continue;
+        }
+        for (size_t index = 0; index < options_.printer_count; ++index) {
+            const std::string response = BuildResponse(index);
+            sendto(fd_,
+                   response.data(),
+                   response.size(),
+                   0,
+                   reinterpret_cast<const sockaddr *>(&sender),
+                   sender_length);
+        }
+    }
+}
+
+std::string SimulatorSsdpResponder::BuildResponse(size_t index) const {
+    return "HTTP/1.1 200 OK\r\n"
+           "Server: Buildroot/2018.02-rc1 UPnP/1.0 ssdpd/1.8\r\n"
+           "Location: " +
+           options_.advertised_host +
+           "\r\n"
+           "ST: " +
+           kSearchTarget +
+           "\r\n"
+           "USN: " +
+           SimulatedSerial(options_, index) +
+           "\r\n"
+           "Cache-Control: max-age=1800\r\n"
+           "DevModel.bambu.com: " +
+           kSimulatedModel +
+           "\r\n"
+           "DevName.bambu.com: Sim-" +
+           std::to_string(index + 1) +
+           "\r\n"
+           "DevConnect.bambu.com: lan\r\n"
+           "DevBind.bambu.com: free\r\n"
+           "\r\n";
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "simulator/SimulatorOptions.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Answers Bambu SSDP M-SEARCH probes with one unicast reply per simulated
+// printer, so discovery can be exercised on loopback.
+class SimulatorSsdpResponder {
+public:
+    explicit SimulatorSsdpResponder(const SimulatorOptions &options);
+    ~SimulatorSsdpResponder();
+
+    SimulatorSsdpResponder(const SimulatorSsdpResponder &) = delete;
+    SimulatorSsdpResponder &operator=(const SimulatorSsdpResponder &) = delete;
+
+    bool Start(std::string *error_message);
+    void Stop();
+
+private:
+    void Run();
+    std::string BuildResponse(size_t index) const;
+
+    const SimulatorOptions &options_;
+    int fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,75 @@
+#include "simulator/SimulatorTls.h"
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+namespace {
+constexpr long kCertificateLifetimeSeconds = 365L * 24 * 60 * 60;
+constexpr unsigned char kSessionIdContext[] = "bambu-simulator";
+
+std::string LastOpenSslError() {
+    const unsigned long code = ERR_get_error();
+    if (code == 0) {
+        return "unknown OpenSSL error";
+    }
+    char buffer[256];
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    return buffer;
+}
+
+X509 *CreateCertificate(EVP_PKEY *key) {
+    X509 *certificate = X509_new();
+    if (!certificate) {
+        return nullptr;
+    }
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), kCertificateLifetimeSeconds);
+    X509_set_pubkey(certificate, key);
+    X509_NAME *name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name,
+                               "CN",
+                               MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char *>("bambu-simulator"),
+                               -1,
+                               -1,
+                               0);
+    X509_set_issuer_name(certificate, name);
+    if (X509_sign(certificate, key, EVP_sha256()) == 0) {
+        X509_free(certificate);
+        return nullptr;
+    }
+    return certificate;
+}
+}  // namespace
+
+SSL_CTX *CreateSimulatorTlsContext(std::string *error_message) {
+    SSL_CTX *context = SSL_CTX_new(TLS_server_method());
+    if (!context) {
+        if (error_message) {
+            *error_message = "SSL_CTX_new failed: " + LastOpenSslError();
+        }
+        return nullptr;
+    }
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    SSL_CTX_set_session_id_context(context, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *certificate = key ? CreateCertificate(key) : nullptr;
+    const bool loaded = certificate && SSL_CTX_use_certificate(context, certificate) == 1 &&
+                        SSL_CTX_use_PrivateKey(context, key) == 1;
+    if (!loaded && error_message) {
+        *error_message = "unable to create simulator certificate: " + LastOpenSslError();
+    }
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    if (!loaded) {
+        SSL_CTX_free(context);
+        return nullptr;
+    }
+    return context;
+}
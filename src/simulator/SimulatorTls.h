@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+// Builds a server context with a freshly generated self-signed certificate, matching
+// the self-signed certificates Bambu printers present in LAN mode.
+SSL_CTX *CreateSimulatorTlsContext(std::string *error_message);
@@ -0,0 +1,213 @@
+#include "simulator/SimulatedPrinter.h"
+#include "simulator/SimulatorFtpsServer.h"
+#include "simulator/SimulatorMqttServer.h"
+#include "simulator/SimulatorNet.h"
+#include "simulator/SimulatorOptions.h"
+#include "simulator/SimulatorSsdpResponder.h"
+#include "simulator/SimulatorTls.h"
+
+#include <openssl/ssl.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace {
+std::atomic<bool> g_running{true};
+
+void HandleSignal(int) {
+    g_running = false;
+}
+
+void PrintUsage(const char *program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --printers N          virtual printers to simulate (default 10)\n"
+        "  --port PORT           MQTT/TLS port (default 8883)\n"
+        "  --ftps-port PORT      implicit FTPS port, 0 to disable (default 990)\n"
+        "  --ssdp-port PORT      answer SSDP M-SEARCH probes on this UDP port (default off)\n"
+        "  --bind ADDRESS        listen address (default 0.0.0.0)\n"
+        "  --host ADDRESS        host written to --write-config (default 127.0.0.1)\n"
+        "  --access-code CODE    access code for every printer (default 12345678)\n"
+        "  --serial-prefix TEXT  serial prefix (default SIM)\n"
+        "  --rate HZ             reports per second per printer (default 1)\n"
+        "  --prepare-seconds N   time spent in PREPARE (default 5)\n"
+        "  --print-seconds N     time spent in RUNNING (default 120)\n"
+        "  --drop-rate P         chance per connection per second of a dropped session\n"
+        "  --stale-file-rate P   chance a report carries the previous gcode_file\n"
+        "  --ack-delay-ms N      delay before command acknowledgements\n"
+        "  --stats-interval N    seconds between stats lines, 0 to disable (default 5)\n"
+        "  --seed N              random seed (default 1)\n"
+        "  --write-config PATH   write a [printers] config section for the fleet\n",
+        program);
+}
+
+bool ParseOptions(int argc, char **argv, SimulatorOptions *options) {
+    for (int index = 1; index < argc; ++index) {
+        const std::string flag = argv[index];
+        if (flag == "--help" || flag == "-h") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if (index + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", flag.c_str());
+            return false;
+        }
+        const char *value = argv[++index];
+        if (flag == "--printers") {
+            options->printer_count = std::strtoul(value, nullptr, 10);
+        } else if (flag == "--port") {
+            options->mqtt_port = std::atoi(value);
+        } else if (flag == "--ftps-port") {
+            options->ftps_port = std::atoi(value);
+        } else if (flag == "--ssdp-port") {
+            options->ssdp_port = std::atoi(value);
+        } else if (flag == "--bind") {
+            options->bind_address = value;
+        } else if (flag == "--host") {
+            options->advertised_host = value;
+        } else if (flag == "--access-code") {
+            options->access_code = value;
+        } else if (flag == "--serial-prefix") {
+            options->serial_prefix = value;
+        } else if (flag == "--rate") {
+            options->report_rate_hz = std::atof(value);
+        } else if (flag == "--prepare-seconds") {
+            options->prepare_seconds = std::atoi(value);
+        } else if (flag == "--print-seconds") {
+            options->print_seconds = std::atoi(value);
+        } else if (flag == "--drop-rate") {
+            options->drop_rate = std::atof(value);
+        } else if (flag == "--stale-file-rate") {
+            options->stale_file_rate = std::atof(value);
+        } else if (flag == "--ack-delay-ms") {
+            options->ack_delay_ms = std::atoi(value);
+        } else if (flag == "--stats-interval") {
+            options->stats_interval_seconds = std::atoi(value);
+        } else if (flag == "--seed") {
+            options->seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (flag == "--write-config") {
+            options->config_path = value;
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return false;
+        }
+    }
+    if (options->printer_count == 0 || options->report_rate_hz <= 0.0) {
+        std::fprintf(stderr, "--printers and --rate must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+bool WriteFleetConfig(const SimulatorOptions &options) {
+    std::ofstream out(options.config_path);
+    if (!out) {
+        return false;
+    }
+    out << "[printers]\ncount=" << options.printer_count << "\n";
+    for (size_t index = 0; index < options.printer_count; ++index) {
+        out << "\n[printers/" << index << "]\n"
+            << "name=Sim-" << (index + 1) << "\n"
+            << "host=" << options.advertised_host << "\n"
+            << "access_code=" << options.access_code << "\n"
+            << "serial=" << SimulatedSerial(options, index) << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+void PrintStats(const SimulatorStats &stats, double seconds, uint64_t *last_reports) {
+    const uint64_t reports = stats.reports_published.load();
+    std::printf("sessions=%llu connects=%llu reports/s=%.0f MB=%.1f commands=%llu "
+                "jobs=%llu finished=%llu acks=%llu uploads=%llu upload_MB=%.1f drops=%llu\n",
+                static_cast<unsigned long long>(stats.active_connections.load()),
+                static_cast<unsigned long long>(stats.connections.load()),
+                static_cast<double>(reports - *last_reports) / seconds,
+                static_cast<double>(stats.bytes_published.load()) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(stats.commands_received.load()),
+                static_cast<unsigned long long>(stats.jobs_started.load()),
+                static_cast<unsigned long long>(stats.jobs_finished.load()),
+                static_cast<unsigned long long>(stats.acks_sent.load()),
+                static_cast<unsigned long long>(stats.uploads.load()),
+                static_cast<double>(stats.bytes_uploaded.load()) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(stats.dropped_connections.load()));
+    std::fflush(stdout);
+    *last_reports = reports;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+    SimulatorOptions options;
+    if (!ParseOptions(argc, argv, &options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (!options.config_path.empty()) {
+        if (!WriteFleetConfig(options)) {
+            std::fprintf(stderr, "Unable to write %s\n", options.config_path.c_str());
+            return 1;
+        }
+        std::printf("Wrote %zu printers to %s\n",
+                    options.printer_count,
+                    options.config_path.c_str());
+    }
+
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    RaiseFileDescriptorLimit();
+
+    std::string error;
+    SSL_CTX *context = CreateSimulatorTlsContext(&error);
+    if (!context) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    SimulatorStats stats;
+    SimulatorMqttServer mqtt_server(options, context, &stats);
+    if (!mqtt_server.Listen(&error)) {
+        std::fprintf(stderr, "MQTT listen failed: %s\n", error.c_str());
+        SSL_CTX_free(context);
+        return 1;
+    }
+    SimulatorFtpsServer ftps_server(options, context, &stats);
+    if (options.ftps_port > 0 && !ftps_server.Start(&error)) {
+        std::fprintf(stderr, "FTPS listen failed (uploads will fail): %s\n", error.c_str());
+    }
+    SimulatorSsdpResponder ssdp_responder(options);
+    if (options.ssdp_port > 0 && !ssdp_responder.Start(&error)) {
+        std::fprintf(stderr, "SSDP listen failed: %s\n", error.c_str());
+    }
+
+    std::printf("Simulating %zu printers on MQTT port %d, FTPS port %d\n",
+                options.printer_count,
+                options.mqtt_port,
+                options.ftps_port);
+    std::fflush(stdout);
+
+    std::thread mqtt_thread([&mqtt_server]() { mqtt_server.Run(g_running); });
+    auto last_stats = std::chrono::steady_clock::now();
+    uint64_t last_reports = 0;
+    while (g_running.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double>(now - last_stats).count();
+        if (options.stats_interval_seconds > 0 && elapsed >= options.stats_interval_seconds) {
+            PrintStats(stats, elapsed, &last_reports);
+            last_stats = now;
+        }
+    }
+
+    mqtt_thread.join();
+    ssdp_responder.Stop();
+    ftps_server.Stop();
+    SSL_CTX_free(context);
+    return 0;
+}